@@ -4,11 +4,14 @@
  *  Created on: 21. 5. 2019
  *      Author: ondra
  */
+#include <algorithm>
+#include <cctype>
 #include <iostream>
 #include <sstream>
 #include <unordered_map>
 
 #include <rpc/rpcServer.h>
+#include <imtjson/array.h>
 #include <imtjson/operations.h>
 #include "shared/toString.h"
 #include "proxy.h"
@@ -17,15 +20,20 @@
 #include <ctime>
 
 #include "../brokers/api.h"
+#include "../brokers/jsonreader.h"
+#include "../brokers/marketstream.h"
+#include "../brokers/publiccache.h"
+#include "../brokers/tradesync.h"
 #include <imtjson/stringValue.h>
 #include "../shared/linear_map.h"
-#include "../shared/iterator_stream.h"
 #include <imtjson/binary.h>
 #include <imtjson/streams.h>
 #include <imtjson/binjson.tcc>
 #include "../main/sgn.h"
+#include "../shared/logOutput.h"
 
 using namespace json;
+using ondra_shared::logError;
 
 static Value keyFormat = {Object
 							("name","pubKey")
@@ -36,12 +44,16 @@ static Value keyFormat = {Object
 							("type","string")
 							("label","Private key")};
 
+class UserStreamProtocol;
+
 class Interface: public AbstractBrokerAPI {
 public:
 	Proxy px;
 
 
-	Interface(const std::string &path):AbstractBrokerAPI(path, keyFormat) {}
+	Interface(const std::string &path):Interface(path, createTickerStream()) {}
+	Interface(const std::string &path, std::shared_ptr<MarketDataStream> tickerStream)
+		:AbstractBrokerAPI(path, keyFormat),tickerStream(tickerStream) {}
 
 
 	virtual double getBalance(const std::string_view & symb) override;
@@ -62,7 +74,7 @@ public:
 	virtual void onLoadApiKey(json::Value keyData) override;
 	virtual void onInit() override;
 	virtual Interface *createSubaccount(const std::string &path) {
-		return new Interface(path);
+		return new Interface(path, tickerStream);
 	}
 
 
@@ -79,6 +91,7 @@ public:
 
 
 	TradeMap tradeMap;
+	IncrementalTradeSync tradeSync;
 	bool needSyncTrades = true;
 	std::size_t lastFromTime = -1;
 
@@ -91,6 +104,17 @@ public:
 
 	void initSymbols();
 
+	///Ticker stream - public data, shared with subaccounts
+	std::shared_ptr<MarketDataStream> tickerStream;
+	///User data stream - orders and fills of this account
+	std::unique_ptr<MarketDataStream> userStream;
+	UserStreamProtocol *userProtocol = nullptr;
+	std::string listenKey;
+	std::uint64_t listenKeyRefresh = 0;
+
+	static std::shared_ptr<MarketDataStream> createTickerStream();
+	void updateUserStream();
+
 };
 
 
@@ -142,50 +166,57 @@ void Interface::updateBalCache() {
 
 	 if (lastId.hasValue()) {
 
-
-		 Value r = px.private_request(Proxy::GET,"/api/v3/myTrades", Object
-				 ("fromId", lastId)
-				 ("symbol", pair)
-				 );
-
-		 r = r.map([&](Value x) ->Value{
-			if (x["id"] == lastId) return json::undefined;
-			else return x;
-		  });
-
-		 TradeHistory h(mapJSON(r,[&](Value x){
-			 double size = x["qty"].getNumber();
-			 double price = x["price"].getNumber();
-			 StrViewA comass = x["commissionAsset"].getString();
-			 if (!x["isBuyer"].getBool()) size = -size;
-			 double comms = x["commission"].getNumber();
-			 double eff_size = size;
-			 double eff_price = price;
-			 if (comass == StrViewA(minfo.asset_symbol)) {
-				 eff_size -= comms;
-				 eff_price =  std::abs(size * price) / eff_size;
-			 } else if (comass == StrViewA(minfo.currency_symbol)) {
-				 eff_price += comms/size;
+		 if (userStream != nullptr && !userStream->needSyncTrades(pair)) {
+			 return TradesSync{{}, lastId};
+		 }
+		 unsigned int fillsVer = userStream != nullptr?userStream->getFillsVersion(pair):0;
+
+		 TradesSync res = tradeSync.sync(lastId, [&](const Value &cursor, unsigned int limit) {
+			 Value r = px.private_request(Proxy::GET,"/api/v3/myTrades", Object
+					 ("fromId", cursor)
+					 ("symbol", pair)
+					 ("limit", limit)
+					 );
+			 bool more = r.size() >= limit;
+
+			 r = r.map([&](Value x) ->Value{
+				if (x["id"] == cursor) return json::undefined;
+				else return x;
+			  });
+
+			 IncrementalTradeSync::Page page{mapJSON(r,[&](Value x){
+				 double size = x["qty"].getNumber();
+				 double price = x["price"].getNumber();
+				 StrViewA comass = x["commissionAsset"].getString();
+				 if (!x["isBuyer"].getBool()) size = -size;
+				 double comms = x["commission"].getNumber();
+				 double eff_size = size;
+				 double eff_price = price;
+				 if (comass == StrViewA(minfo.asset_symbol)) {
+					 eff_size -= comms;
+					 eff_price =  std::abs(size * price) / eff_size;
+				 } else if (comass == StrViewA(minfo.currency_symbol)) {
+					 eff_price += comms/size;
+				 }
+
+				 return Trade {
+					 x["id"],
+					 x["time"].getUIntLong(),
+					 size,
+					 price,
+					 eff_size,
+					 eff_price
+				 };
+			 }, TradeHistory()), Value(), more};
+
+			 for (auto &&t: page.trades) {
+				 if (!page.cursor.defined() || Value::compare(page.cursor, t.id) < 0) page.cursor = t.id;
 			 }
-
-			 return Trade {
-				 x["id"],
-				 x["time"].getUIntLong(),
-				 size,
-				 price,
-				 eff_size,
-				 eff_price
-			 };
-		 }, TradeHistory()));
-
-		 std::sort(h.begin(), h.end(),[&](const Trade &a, const Trade &b) {
-			 return Value::compare(a.id,b.id) < 0;
+			 return page;
 		 });
-		 if (!h.empty()) lastId = h.back().id;
-		 return TradesSync{
-			 h,
-			 lastId
-		 };
+		 //there are more trades than one sync can download, don't mark synced
+		 if (userStream != nullptr && !tradeSync.hasMore()) userStream->setTradesSynced(pair, fillsVer);
+		 return res;
 	 } else {
 		 Value r = px.private_request(Proxy::GET,"/api/v3/myTrades", Object
 				 ("symbol", pair));
@@ -220,9 +251,131 @@ static Value extractOrderID(StrViewA id) {
 
 }
 
+///Receives tickers of subscribed pairs
+class TickerProtocol: public MarketDataStream::IProtocol {
+public:
+	virtual std::string getUrl() override {
+		return "wss://stream.binance.com:9443/ws";
+	}
+	virtual void subscribe(simpleServer::WebSocketStream &ws, const std::string &pair) override {
+		std::string stream;
+		std::transform(pair.begin(), pair.end(), std::back_inserter(stream), [](char c){return std::tolower(c);});
+		stream.append("@ticker");
+		ws.postText(Value(Object
+				("method","SUBSCRIBE")
+				("params",Value(json::array,{StrViewA(stream)}))
+				("id",reqId++)).stringify());
+	}
+	virtual void onMessage(MarketDataStream &stream, json::Value msg) override {
+		if (msg["e"].getString() == "24hrTicker") {
+			std::string symbol = msg["s"].getString();
+			stream.updateTicker(symbol, IStockApi::Ticker{
+				msg["b"].getNumber(),
+				msg["a"].getNumber(),
+				msg["c"].getNumber(),
+				msg["E"].getUIntLong()
+			});
+		}
+	}
+protected:
+	unsigned int reqId = 1;
+};
+
+///Receives execution reports of the account
+class UserStreamProtocol: public MarketDataStream::IProtocol {
+public:
+	void setListenKey(const std::string &key) {
+		std::lock_guard<std::mutex> _(lock);
+		listenKey = key;
+		expired = false;
+	}
+	bool isExpired() const {
+		std::lock_guard<std::mutex> _(lock);
+		return expired;
+	}
+	virtual std::string getUrl() override {
+		std::lock_guard<std::mutex> _(lock);
+		if (listenKey.empty() || expired) throw std::runtime_error("Listen key is not available");
+		return "wss://stream.binance.com:9443/ws/"+listenKey;
+	}
+	virtual void subscribe(simpleServer::WebSocketStream &, const std::string &) override {
+		//user stream reports all pairs
+	}
+	virtual void onMessage(MarketDataStream &stream, json::Value msg) override {
+		StrViewA event = msg["e"].getString();
+		if (event == "executionReport") {
+			std::string symbol = msg["s"].getString();
+			StrViewA status = msg["X"].getString();
+			double size = 0;
+			if (status == "NEW" || status == "PARTIALLY_FILLED") {
+				size = (msg["S"].getString() == "SELL"?-1:1)*(msg["q"].getNumber() - msg["z"].getNumber());
+			}
+			stream.updateOrder(symbol, IStockApi::Order{
+				msg["i"],
+				extractOrderID(msg["c"].getString()),
+				size,
+				msg["p"].getNumber()
+			});
+			if (msg["x"].getString() == "TRADE") stream.reportFill(symbol);
+		} else if (event == "listenKeyExpired") {
+			{
+				std::lock_guard<std::mutex> _(lock);
+				expired = true;
+			}
+			stream.reconnect();
+		}
+	}
+	//binance sends ping every 3 minutes, account can be quiet for long time
+	virtual unsigned int getIOTimeout() const override {return 600000;}
+protected:
+	mutable std::mutex lock;
+	std::string listenKey;
+	bool expired = false;
+};
+
+static simpleServer::HttpClient createStreamClient() {
+	return simpleServer::HttpClient("MMBot Binance broker",
+			simpleServer::newHttpsProvider(),
+			simpleServer::newNoProxyProvider());
+}
+
+std::shared_ptr<MarketDataStream> Interface::createTickerStream() {
+	return std::make_shared<MarketDataStream>(createStreamClient(), std::make_unique<TickerProtocol>());
+}
+
+void Interface::updateUserStream() {
+	if (!px.hasKey()) return;
+	try {
+		std::uint64_t n = MarketDataStream::now();
+		if (userStream == nullptr) {
+			auto proto = std::make_unique<UserStreamProtocol>();
+			userProtocol = proto.get();
+			userStream = std::make_unique<MarketDataStream>(createStreamClient(), std::move(proto));
+		}
+		if (listenKey.empty() || userProtocol->isExpired()) {
+			Value r = px.apikey_request(Proxy::POST,"/api/v3/userDataStream", Value());
+			listenKey = r["listenKey"].getString();
+			userProtocol->setListenKey(listenKey);
+			userStream->reconnect();
+			listenKeyRefresh = n + 30*60*1000;
+		} else if (listenKeyRefresh < n) {
+			px.apikey_request(Proxy::PUT,"/api/v3/userDataStream", Object("listenKey", listenKey));
+			listenKeyRefresh = n + 30*60*1000;
+		}
+	} catch (std::exception &e) {
+		logError("User data stream is not available: $1", e.what());
+		listenKey.clear();
+	}
+}
+
 Interface::Orders Interface::getOpenOrders(const std::string_view & pair) {
+	if (userStream != nullptr) {
+		auto cached = userStream->getOpenOrders(pair);
+		if (cached.has_value()) return *cached;
+	}
+	unsigned int ordersVer = userStream != nullptr?userStream->getOrdersVersion(pair):0;
 	Value resp = px.private_request(Proxy::GET,"/api/v3/openOrders", Object("symbol",pair));
-	return mapJSON(resp, [&](Value x) {
+	Orders res = mapJSON(resp, [&](Value x) {
 		Value id = x["clientOrderId"];
 		Value eoid = extractOrderID(id.getString());
 		return Order {
@@ -232,6 +385,8 @@ Interface::Orders Interface::getOpenOrders(const std::string_view & pair) {
 			x["price"].getNumber()
 		};
 	}, Orders());
+	if (userStream != nullptr) userStream->setOrders(pair, Orders(res), ordersVer);
+	return res;
 }
 
 static std::uint64_t now() {
@@ -240,38 +395,38 @@ static std::uint64_t now() {
 						 ).count();
 }
 
-static Value indexBySymbol(Value data) {
-	Object bld;
-	for (Value d:data) bld.set(d["symbol"].getString(), d);
-	return bld;
+///Downloads public data as text, the download is shared by all subaccounts
+static json::String getPublicText(Proxy &px, const std::string &path, unsigned int ttl) {
+	return PublicDataCache::getInstance().get(px.apiUrl + path, ttl, [&]{
+		return Value(px.public_request_text(path, Value()));
+	}).toString();
 }
 
 Interface::Ticker Interface::getTicker(const std::string_view &pair) {
+	 auto streamed = tickerStream->getTicker(pair);
+	 if (streamed.has_value()) return *streamed;
+
 	 if (tickerCache.empty()) {
-		 Value book = indexBySymbol(px.public_request("/api/v3/ticker/bookTicker", Value()));
-		 Value price = indexBySymbol(px.public_request("/api/v3/ticker/price", Value()));
-		 auto bs = ondra_shared::iterator_stream(book);
-		 auto ps = ondra_shared::iterator_stream(price);
+		 //responses contain all markets, read them without building json::Value
+		 auto tm = now();
 		 std::vector<Tickers::value_type> tk;
-		 while (!!bs && !!ps) {
-			 Value b = *bs;
-			 Value p = *ps;
-			 if (b.getKey() < p.getKey()) bs();
-			 else if (b.getKey() > p.getKey()) ps();
-			 else {
-				 tk.push_back(Tickers::value_type(
-						 p.getKey(),
-						 {
-								 b["bidPrice"].getNumber(),
-								 b["askPrice"].getNumber(),
-								 p["price"].getNumber(),
-								 now(),
-						 }));
-				 bs();
-				 ps();
-			 }
+		 json::String book = getPublicText(px, "/api/v3/ticker/bookTicker", 5000);
+		 JsonReader brd(std::string_view(book.c_str(), book.length()));
+		 readTickers(brd, JsonTickerFields{"symbol","bidPrice","askPrice",""}, tm, [&](std::string_view symbol) {
+			 tk.push_back(Tickers::value_type(std::string(symbol), Ticker{}));
+			 return &tk.back().second;
+		 });
+		 std::sort(tk.begin(), tk.end(), [](const auto &a, const auto &b){return a.first < b.first;});
+		 Tickers tickers(std::move(tk));
+		 json::String price = getPublicText(px, "/api/v3/ticker/price", 5000);
+		 JsonReader prd(std::string_view(price.c_str(), price.length()));
+		 if (prd.openArray()) {
+			 prd.forEachObject(std::array<std::string_view,2>{"symbol","price"}, [&](const std::array<std::string_view,2> &v) {
+				 auto iter = tickers.find(v[0]);
+				 if (iter != tickers.end()) iter->second.last = JsonReader::requireNumber(v[1]);
+			 });
 		 }
-		 tickerCache = Tickers(std::move(tk));
+		 tickerCache = std::move(tickers);
 	 }
 
 	 auto iter=tickerCache.find(pair);
@@ -306,6 +461,9 @@ json::Value Interface::placeOrder(const std::string_view & pair,
 		json::Value replaceId,
 		double replaceSize) {
 
+	//cached orders would miss this change until the stream reports it
+	if (userStream != nullptr) userStream->invalidateOrders(pair);
+
 	if (replaceId.defined()) {
 		Value r = px.private_request(Proxy::DELETE,"/api/v3/order",Object
 				("symbol", pair)
@@ -332,15 +490,35 @@ json::Value Interface::placeOrder(const std::string_view & pair,
 
 bool Interface::reset() {
 	balanceCache = Value();
+	//tickers are parsed again, the download is shared through PublicDataCache
 	tickerCache.clear();
 	orderCache = Value();
 	needSyncTrades = true;
+	updateUserStream();
 	return true;
 }
 
 void Interface::initSymbols() {
 	if (symbols.empty()) {
-		Value res = px.public_request("/api/v1/exchangeInfo",Value());
+		//symbols change rarely, they are stored in the cache file and shared by subaccounts
+		Value res = PublicDataCache::getInstance().getPersistent(px.apiUrl + "/api/v1/exchangeInfo", 3600, [&]{
+			Value info = px.public_request("/api/v1/exchangeInfo",Value());
+			//store only fields used below, the response is large
+			Array smbs;
+			for (Value smb: info["symbols"]) {
+				smbs.push_back(Object
+						("symbol", smb["symbol"])
+						("baseAsset", smb["baseAsset"])
+						("quoteAsset", smb["quoteAsset"])
+						("quotePrecision", smb["quotePrecision"])
+						("baseAssetPrecision", smb["baseAssetPrecision"])
+						("filters", smb["filters"].filter([](Value f){
+							auto ft = f["filterType"].getString();
+							return ft == "LOT_SIZE" || ft == "PRICE_FILTER" || ft == "MIN_NOTIONAL";
+						})));
+			}
+			return Value(Object("symbols", smbs));
+		});
 
 
 		using VT = Symbols::value_type;
@@ -410,6 +588,10 @@ bool Interface::tradeOrder(const Trade &a, const Trade &b) {
 inline void Interface::onLoadApiKey(json::Value keyData) {
 	px.privKey = keyData["privKey"].getString();
 	px.pubKey = keyData["pubKey"].getString();
+	//keys has been changed, stream must be opened with new keys
+	userStream.reset();
+	userProtocol = nullptr;
+	listenKey.clear();
 }
 
 inline Value Interface::generateOrderId(Value clientId) {
@@ -71,6 +71,13 @@ json::Value Proxy::public_request(std::string method, json::Value data) {
 
 }
 
+json::String Proxy::public_request_text(std::string method, json::Value data) {
+	std::ostringstream urlbuilder;
+	urlbuilder << apiUrl <<  method;
+	buildParams(data, urlbuilder);
+	return httpc.GETText(urlbuilder.str());
+}
+
 static std::string signData(std::string_view key, std::string_view data) {
 	unsigned char dbuff[100];
 	unsigned int dbuff_size = sizeof(dbuff);
@@ -113,9 +120,22 @@ json::Value Proxy::private_request(Method method, std::string command, json::Val
 	std::string url = urlbuilder.str();
 	request.append("&signature=").append(sign);
 
+	return send(method, url, request);
+}
+
+json::Value Proxy::apikey_request(Method method, std::string command, json::Value data) {
+	if (!hasKey())
+		throw std::runtime_error("Function requires valid API keys");
 
+	std::ostringstream databld;
+	buildParams(data, databld);
+	std::string request = databld.str();
+	if (!request.empty()) request = request.substr(1);
 
-	std::ostringstream response;
+	return send(method, command, request);
+}
+
+json::Value Proxy::send(Method method, std::string url, const std::string &request) {
 
 	json::Value res;
 	//json::Object hdrs("Content-Type","application/x-www-form-urlencoded");
@@ -33,7 +33,11 @@ public:
 	};
 
 	json::Value public_request(std::string method, json::Value data);
+	///Public request, returns the body as text (for JsonReader)
+	json::String public_request_text(std::string method, json::Value data);
 	json::Value private_request(Method method, std::string command, json::Value data);
+	///Request, which requires API key but no signature (user data stream)
+	json::Value apikey_request(Method method, std::string command, json::Value data);
 
 	bool hasKey() const;
 	void setTime(std::uint64_t t);
@@ -46,6 +50,7 @@ private:
 	std::int64_t time_diff = 0;
 	std::uint64_t time_sync = 0;
 	void buildParams(const json::Value& params, std::ostream& data);
+	json::Value send(Method method, std::string url, const std::string &request);
 };
 
 
@@ -19,6 +19,8 @@
 #include "../imtjson/src/imtjson/string.h"
 #include "../imtjson/src/imtjson/value.h"
 #include "../shared/stringview.h"
+#include "../brokers/jsonreader.h"
+#include "../brokers/publiccache.h"
 using json::Object;
 using json::String;
 using json::Value;
@@ -241,32 +243,36 @@ IStockApi::TradesSync Interface::syncTrades(json::Value lastId, const std::strin
 			out.lastId = {0, now};
 		} else {
 			out.lastId = {data[0][0], data[0][2]};
-			fees[std::string(pair)] = getFeeFromTrade(data[0],pinfo);
+			Value x = data[0];
+			fees[std::string(pair)] = getFeeFromTrade(x[4].getNumber(), x[5].getNumber(), x[9].getNumber(), x[10].getString(), pinfo);
 		}
 	} else {
-		Value data = signedPOST(path,Object("sort",1)("start",lastId[1])("end",now));
-		Value anchor = lastId[0];
+		//history can be long, read it without building json::Value
+		json::String text = signedPOSTText(path,Object("sort",1)("start",lastId[1])("end",now));
+		std::uint64_t anchor = lastId[0].getUIntLong();
 		bool m = isMarginPair(pair);
-		Value flt = data.filter([&](Value x){
-			if (anchor == x[0]) return false;
-			return x[6].getString().startsWith("EXCHANGE") != m;
-		});
-		if (!data.empty()) {
-			auto ln = data.size()-1;
-			bool wasAnchor = data[ln][0] == anchor;
-			out.lastId = {data[ln][0], data[ln][2].getUIntLong()+(wasAnchor?1:0)};
-		} else {
-			out.lastId = lastId;
-		}
+		bool empty = true;
+		bool wasAnchor = false;
+		std::uint64_t lastTradeId = 0;
+		std::uint64_t lastTime = 0;
 		double lastFees = 0.001;
-		for (Value x: flt) {
-			double price = x[5].getNumber();
-			double size = x[4].getNumber();
-			StrViewA feecur = x[10].getString();
+		JsonReader rd(std::string_view(text.c_str(), text.length()));
+		//[ID, PAIR, MTS_CREATE, ORDER_ID, EXEC_AMOUNT, EXEC_PRICE, ORDER_TYPE, ORDER_PRICE, MAKER, FEE, FEE_CURRENCY]
+		if (rd.openArray()) rd.forEachArray<11>([&](const std::array<std::string_view, 11> &x) {
+			std::uint64_t id = JsonReader::toUInt(x[0]);
+			empty = false;
+			lastTradeId = id;
+			lastTime = JsonReader::toUInt(x[2]);
+			wasAnchor = id == anchor;
+			if (wasAnchor) return;
+			if ((x[6].substr(0,8) == "EXCHANGE") == m) return;
+			double price = JsonReader::requireNumber(x[5]);
+			double size = JsonReader::requireNumber(x[4]);
+			StrViewA feecur(x[10].data(), x[10].length());
 			double eff_price = price;
 			double eff_size = size;
-			double fee = x[9].getNumber();
-			lastFees = getFeeFromTrade(x, pinfo);
+			double fee = JsonReader::toNumber(x[9]);
+			lastFees = getFeeFromTrade(size, price, fee, feecur, pinfo);
 			if (feecur == pinfo.asset && !m) {
 				eff_size = size + fee;
 				eff_price = size * price /eff_size;
@@ -276,8 +282,13 @@ IStockApi::TradesSync Interface::syncTrades(json::Value lastId, const std::strin
 				eff_price = price + lastFees*price*(size>0?1:-1);
 			}
 			out.trades.push_back({
-				x[0],x[2].getUIntLong(),size,price,eff_size,eff_price
+				id,lastTime,size,price,eff_size,eff_price
 			});
+		});
+		if (!empty) {
+			out.lastId = {lastTradeId, lastTime+(wasAnchor?1:0)};
+		} else {
+			out.lastId = lastId;
 		}
 		if (!out.trades.empty()) {
 			fees[std::string(pair)] = lastFees;
@@ -408,8 +419,7 @@ IStockApi::Ticker Interface::getTicker(const std::string_view &pair) {
 
 		std::string req("/v2/tickers?symbols=");
 		req.append(piter->second.tsymbol.str());
-		Value v = publicGET(req);
-		updateTicker(v[0]);
+		storeTickers(publicGETText(req));
 		iter = tickers.find(std::string_view(piter->second.tsymbol.str()));
 		if (iter == tickers.end()) {
 			throw std::runtime_error("Ticker not available");
@@ -421,7 +431,10 @@ IStockApi::Ticker Interface::getTicker(const std::string_view &pair) {
 const PairList& Interface::getPairs() const {
 	auto now = std::chrono::system_clock::now();
 	if (now < pairListExpire) return pairList;
-	auto r = publicGET("/v2/conf/pub:info:pair");
+	//pairs change rarely, they are stored in the cache file and shared by subaccounts
+	auto r = PublicDataCache::getInstance().getPersistent("bitfinex:/v2/conf/pub:info:pair", 3600, [&]{
+		return publicGET("/v2/conf/pub:info:pair");
+	});
 	pairList =readPairs(r);
 	pairListExpire = now+std::chrono::hours(1);
 	return pairList;
@@ -488,27 +501,26 @@ void Interface::updateTickers() {
 	std::string req = prepareUpdateRequest(tickers);
 	if (req.empty()) return;
 	req = "/v2/tickers?symbols="+req;
-	Value v = publicGET(req);
-	for (Value t: v) updateTicker(t);
+	storeTickers(publicGETText(req));
 	needUpdateTickers = false;
 }
 
-void Interface::updateTicker(Value v) {
-	std::string symbol = v[0].getString();
-	Ticker tk;
-	tk.bid = v[1].getNumber();
-	tk.ask = v[3].getNumber();
-	tk.last = v[7].getNumber();
-	tk.time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
-	tickers[std::move(symbol)] = std::move(tk);
+void Interface::storeTickers(const json::String &text) {
+	auto now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	JsonReader rd(std::string_view(text.c_str(), text.length()));
+	//[SYMBOL, BID, BID_SIZE, ASK, ASK_SIZE, DAILY_CHANGE, DAILY_CHANGE_RELATIVE, LAST_PRICE]
+	if (rd.openArray()) rd.forEachArray<8>([&](const std::array<std::string_view, 8> &v) {
+		Ticker tk;
+		tk.bid = JsonReader::requireNumber(v[1]);
+		tk.ask = JsonReader::requireNumber(v[3]);
+		tk.last = JsonReader::requireNumber(v[7]);
+		tk.time = now;
+		tickers[std::string(v[0])] = std::move(tk);
+	});
 }
 
 
-double Interface::getFeeFromTrade(Value trade, const PairInfo &pair) {
-	double price = trade[5].getNumber();
-	double size = trade[4].getNumber();
-	StrViewA feecur = trade[10].getString();
-	double fee = trade[9].getNumber();
+double Interface::getFeeFromTrade(double size, double price, double fee, StrViewA feecur, const PairInfo &pair) {
 	if (feecur == pair.asset) {
 		return std::abs(fee/size);
 	} else if (feecur == pair.currency) {
@@ -544,6 +556,19 @@ Value Interface::signedPOST(StrViewA path, Value body) const {
 	}
 }
 
+json::String Interface::signedPOSTText(StrViewA path, Value body) const {
+	try {
+		return api.POSTText(path, body,signRequest(path, body));
+	} catch (HTTPJson::UnknownStatusException &e) {
+		try {
+			json::Value v = json::Value::parse(e.response.getBody());
+			throw std::runtime_error(v.join(" ").str());
+		} catch (...) {
+			throw;
+		}
+	}
+}
+
 Value Interface::publicGET(StrViewA path) const {
 	try {
 		return api_pub.GET(path);
@@ -556,3 +581,16 @@ Value Interface::publicGET(StrViewA path) const {
 		}
 	}
 }
+
+json::String Interface::publicGETText(StrViewA path) const {
+	try {
+		return api_pub.GETText(path);
+	} catch (HTTPJson::UnknownStatusException &e) {
+		try {
+			json::Value v = json::Value::parse(e.response.getBody());
+			throw std::runtime_error(v.join(" ").str());
+		} catch (...) {
+			throw;
+		}
+	}
+}
@@ -63,13 +63,16 @@ protected:
 	bool needUpdateTickers=true;
 
 	void updateTickers();
-	void updateTicker(json::Value v);
+	///Stores tickers from the response of /v2/tickers
+	void storeTickers(const json::String &text);
 
 	int genOrderNonce();
 
-	double getFeeFromTrade(json::Value trade, const PairInfo &pair);
+	double getFeeFromTrade(double size, double price, double fee, json::StrViewA feecur, const PairInfo &pair);
 	json::Value signedPOST(json::StrViewA path, json::Value body) const;
+	json::String signedPOSTText(json::StrViewA path, json::Value body) const;
 	json::Value publicGET(json::StrViewA path)  const;
+	json::String publicGETText(json::StrViewA path)  const;
 };
 
 
@@ -24,6 +24,7 @@
 #include <imtjson/binjson.tcc>
 
 #include "../brokers/isotime.h"
+#include "../brokers/tradesync.h"
 #include "../imtjson/src/imtjson/string.h"
 #include "../main/sgn.h"
 #include "../shared/logOutput.h"
@@ -110,6 +111,7 @@ private:
 	Value balanceCache;
 	Value positionCache;
 	Value orderCache;
+	IncrementalTradeSync tradeSync;
 
 	Value readOrders();
 
@@ -171,60 +173,61 @@ inline double Interface::getBalance(const std::string_view &symb) {
 
 inline Interface::TradesSync Interface::syncTrades(json::Value lastId,  const std::string_view &pair) {
 	const SymbolInfo &s = getSymbol(pair);
-	Value trades;
-	Value lastExecId = lastId[1];
 	Value columns = {"execID","transactTime","side","lastQty","lastPx","symbol","execType"};
+
+	auto convertTrades = [&](Value trades, Value lastExecId, Value lastExecTime) {
+		auto idx = trades.findIndex([&](Value item) {
+			return item["execID"] == lastExecId;
+		});
+		if (idx != -1) {
+			trades = trades.slice(idx+1);
+		}
+
+		IncrementalTradeSync::Page page{{}, Value(), false};
+		for (Value item: trades) {
+			lastExecId = item["execID"];
+			lastExecTime = item["transactTime"];
+			page.cursor = {lastExecTime, lastExecId};
+			StrViewA side = item["side"].getString();
+			double mult = side=="Buy"?1:side=="Sell"?-1:0;
+			if (mult == 0) continue;
+			if (s.inverse) mult=-mult;
+			double size = mult*item["lastQty"].getNumber()*s.multiplier;
+			double price = s.inverse?1.0/item["lastPx"].getNumber():item["lastPx"].getNumber();
+			page.trades.push_back(Trade{
+				lastExecId,
+				parseTime(lastExecTime.toString(), ParseTimeFormat::iso),
+				size,
+				price,
+				size,
+				price
+			});
+		}
+		return page;
+	};
+
 	if (lastId.hasValue()) {
-		trades = px.request("GET","/api/v1/execution/tradeHistory",Object
-				("filter", Object("execType",Value(json::array,{"Trade"})))
-				("startTime",lastId[0])
-				("count", 100)
-				("symbol", pair)
-				("columns",columns));
+		return tradeSync.sync(lastId, [&](const Value &cursor, unsigned int limit) {
+			Value trades = px.request("GET","/api/v1/execution/tradeHistory",Object
+					("filter", Object("execType",Value(json::array,{"Trade"})))
+					("startTime",cursor[0])
+					("count", limit)
+					("symbol", pair)
+					("columns",columns));
+			auto page = convertTrades(trades, cursor[1], cursor[0]);
+			page.more = trades.size() >= limit;
+			return page;
+		});
 	} else {
-		trades = px.request("GET","/api/v1/execution/tradeHistory",Object
+		Value trades = px.request("GET","/api/v1/execution/tradeHistory",Object
 				("filter", Object("execType",Value(json::array,{"Trade"})))
 				("reverse",true)
 				("count", 1)
 				("symbol", pair)
 				("columns",columns));
-
-	}
-
-	auto idx = trades.findIndex([&](Value item) {
-		return item["execID"] == lastExecId;
-	});
-	if (idx != -1) {
-		trades = trades.slice(idx+1);
+		auto page = convertTrades(trades, Value(), Value());
+		return TradesSync{page.trades, page.cursor.defined()?page.cursor:lastId};
 	}
-
-	Value lastExecTime = lastId[0];
-	TradesSync resp;
-	for (Value item: trades) {
-		lastExecId = item["execID"];
-		lastExecTime = item["transactTime"];
-		StrViewA side = item["side"].getString();
-		double mult = side=="Buy"?1:side=="Sell"?-1:0;
-		if (mult == 0) continue;
-		if (s.inverse) mult=-mult;
-		double size = mult*item["lastQty"].getNumber()*s.multiplier;
-		double price = s.inverse?1.0/item["lastPx"].getNumber():item["lastPx"].getNumber();
-		resp.trades.push_back(Trade{
-			lastExecId,
-			parseTime(lastExecTime.toString(), ParseTimeFormat::iso),
-			size,
-			price,
-			size,
-			price
-		});
-	}
-
-	if (resp.trades.empty()) {
-		resp.lastId = lastId;
-	} else {
-		resp.lastId = {lastExecTime, lastExecId};
-	}
-	return resp;
 }
 
 inline Interface::Orders Interface::getOpenOrders(const std::string_view &pair) {
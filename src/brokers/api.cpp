@@ -9,6 +9,8 @@
 #include "api.h"
 
 #include <sys/stat.h>
+#include <cstdlib>
+#include <mutex>
 #include <unordered_map>
 #include <imtjson/string.h>
 #include <imtjson/array.h>
@@ -17,8 +19,12 @@
 #include <imtjson/binjson.tcc>
 #include <imtjson/binary.h>
 
+#include "../main/binframe.h"
 #include "../main/istockapi.cpp"
 #include "../shared/stdLogOutput.h"
+#include "httppool.h"
+#include "orderdatadb.h"
+#include "publiccache.h"
 using namespace json;
 
 class BrokerLogProvider: public ondra_shared::StdLogProvider {
@@ -146,6 +152,8 @@ static Value getBrokerInfo(AbstractBrokerAPI &handler, const Value &req) {
 }
 
 static Value reset(AbstractBrokerAPI &handler, const Value &req) {
+	//argument is identifier of the reset round, older robots don't send it
+	PublicDataCache::getInstance().reset(req.getUIntLong());
 	handler.reset();
 	return Value();
 }
@@ -165,20 +173,7 @@ static Value getFees(AbstractBrokerAPI &handler, const Value &req) {
 
 
 static Value getInfo(AbstractBrokerAPI &handler, const Value &req) {
-	AbstractBrokerAPI::MarketInfo nfo ( handler.getMarketInfo(req.getString()) );
-	return Object
-			("asset_step",nfo.asset_step)
-			("currency_step", nfo.currency_step)
-			("asset_symbol",nfo.asset_symbol)
-			("currency_symbol", nfo.currency_symbol)
-			("min_size", nfo.min_size)
-			("min_volume", nfo.min_volume)
-			("fees", nfo.fees)
-			("feeScheme",AbstractBrokerAPI::strFeeScheme[nfo.feeScheme])
-			("leverage", nfo.leverage)
-			("invert_price", nfo.invert_price)
-			("inverted_symbol", nfo.inverted_symbol)
-			("simulator", nfo.simulator);
+	return handler.getMarketInfo(req.getString()).toJSON();
 }
 
 static Value setApiKey(AbstractBrokerAPI &handler, const Value &req) {
@@ -313,31 +308,118 @@ Value AbstractBrokerAPI::callMethod(std::string_view name, Value args) {
 
 
 
+///Reads next message - text or binary frame. Returns undefined at the end of the stream
+static Value readMessage(std::istream &input) {
+	int i = input.get();
+	while (i != EOF && isspace(i)) i = input.get();
+	if (i == EOF) return Value();
+	if (i == BinaryFrame::marker) {
+		char hdr[BinaryFrame::lengthSize];
+		input.read(hdr, sizeof(hdr));
+		std::string data(BinaryFrame::decodeLength(hdr), '\0');
+		input.read(data.data(), data.size());
+		if (!input) throw std::runtime_error("Unexpected end of frame");
+		return BinaryFrame::decode(data);
+	}
+	input.putback(i);
+	return Value::fromStream(input);
+}
+
+static void writeMessage(std::ostream &output, const Value &v, bool binary) {
+	if (binary) {
+		std::string frame = BinaryFrame::encode(v);
+		output.write(frame.data(), frame.size());
+		output.flush();
+	} else {
+		v.toStream(output);
+		output << std::endl;
+	}
+}
+
+///Output shared by responses and events (events are sent from other threads)
+static struct {
+	std::mutex lock;
+	std::ostream *output = nullptr;
+	bool binary = false;
+	bool events = false;
+} channel;
+
+static void writeResponse(std::ostream &output, const Value &v) {
+	std::lock_guard _(channel.lock);
+	writeMessage(output, v, channel.binary);
+}
+
+void AbstractBrokerAPI::sendEvent(json::Value event) {
+	std::lock_guard _(channel.lock);
+	if (channel.output && channel.events) {
+		writeMessage(*channel.output, {"event", event}, channel.binary);
+	}
+}
+
+///Process was started as the standby broker, state of the account is opened by the command "activate"
+static bool startedAsStandby() {
+	return std::getenv("MMBOT_BROKER_STANDBY") != nullptr;
+}
+
+///Persistent public data are shared with the active process, standby process keeps them in memory until it is activated
+static void openPublicCache(const std::string &secure_storage_path) {
+	if (!secure_storage_path.empty()) {
+		PublicDataCache::getInstance().setStorageFile(secure_storage_path + ".cache");
+	}
+}
+
 void AbstractBrokerAPI::dispatch(std::istream& input, std::ostream& output, std::ostream &error, AbstractBrokerAPI &handler) {
 
 	handler.logProvider->setDefault();
+	{
+		std::lock_guard _(channel.lock);
+		channel.output = &output;
+	}
 	try {
 		Value v = Value::fromStream(input);
 		handler.logStream = &error;
 		handler.flushMessages();
-		handler.loadKeys();
-		handler.onInit();
-		while (true) {
-			handler.callMethod(v[0].getString(), v[1]).toStream(output);
+		bool standby = startedAsStandby();
+		if (!standby) {
+			openPublicCache(handler.secure_storage_path);
+			handler.loadKeys();
+			handler.onInit();
+		}
+		while (v.defined()) {
+			Value cmd = v[0];
+			if (cmd.getString() == "binaryFraming") {
+				std::lock_guard _(channel.lock);
+				//reply is sent in the new mode already, mmbot recognizes both
+				channel.binary = v[1].getBool();
+				writeMessage(output, {true, channel.binary}, channel.binary);
+			} else if (cmd.getString() == "enableEvents") {
+				std::lock_guard _(channel.lock);
+				channel.events = v[1].getBool();
+				writeMessage(output, {true, channel.events}, channel.binary);
+			} else if (cmd.getString() == "activate") {
+				//standby process replaced the active process, which held the state of the account
+				if (standby) {
+					OrderDataDB::activate();
+					openPublicCache(handler.secure_storage_path);
+					handler.loadKeys();
+					handler.onInit();
+					standby = false;
+				}
+				writeResponse(output, {true, true});
+			} else {
+				writeResponse(output, handler.callMethod(cmd.getString(), v[1]));
+			}
 			handler.logStream = nullptr;
-			output << std::endl;
-			int i = input.get();
-			while (i != EOF && isspace(i)) i = input.get();
-			if (i == EOF) break;
-			input.putback(i);
-			v = Value::fromStream(input);
+			v = readMessage(input);
 			handler.logStream = &error;
 			handler.flushMessages();
 		}
 	} catch (std::exception &e) {
-		Value({false, e.what()}).toStream(output);
-		output << std::endl;
+		writeResponse(output, {false, e.what()});
 	}
+	std::lock_guard _(channel.lock);
+	channel.output = nullptr;
+	channel.events = false;
 	handler.logStream = nullptr;
 }
 
@@ -417,9 +499,27 @@ double AbstractBrokerAPI::getBalance(const std::string_view & symb, const std::s
 	return getBalance(symb);
 }
 
-AbstractBrokerAPI::PageData AbstractBrokerAPI::fetchPage(const std::string_view &,
-		const std::string_view &, const PageData &) {
-	return {};
+AbstractBrokerAPI::PageData AbstractBrokerAPI::fetchPage(const std::string_view &method,
+		const std::string_view &vpath, const PageData &) {
+	PageData resp;
+	if (vpath == "/http") {
+		if (method != "GET") {
+			resp.code = 405;
+			return resp;
+		}
+		resp.code = 200;
+		resp.headers.emplace_back("Content-Type","application/json");
+		resp.body = HttpClientPool::getInstance().getMetrics().stringify().str();
+	} else if (vpath == "/cache") {
+		if (method != "GET") {
+			resp.code = 405;
+			return resp;
+		}
+		resp.code = 200;
+		resp.headers.emplace_back("Content-Type","application/json");
+		resp.body = PublicDataCache::getInstance().getMetrics().stringify().str();
+	}
+	return resp;
 }
 
 void AbstractBrokerAPI::enable_debug(bool enable) {
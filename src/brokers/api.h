@@ -102,6 +102,15 @@ public:
 
 	virtual json::Value callMethod(std::string_view name, json::Value args);
 
+	///Sends unsolicited event to mmbot
+	/** Events are sent only when mmbot enabled them by the command "enableEvents", otherwise
+	 * they are dropped. Function can be called from any thread
+	 *
+	 * @param event event object. It should contain "type" (for example "fill") and "pair".
+	 * mmbot runs the traders of the pair immediately
+	 */
+	static void sendEvent(json::Value event);
+
 protected:
 	bool debug_mode = false;
 	std::string secure_storage_path;
@@ -10,18 +10,24 @@
 #include "httpjson.h"
 
 #include <simpleServer/urlencode.h>
+#include "httppool.h"
 #include "../shared/logOutput.h"
 #include "log.h"
 
 using ondra_shared::logDebug;
 using simpleServer::urlEncode;
 
+static const unsigned int connectTimeout = 5000;
+static const unsigned int ioTimeout = 10000;
+
 HTTPJson::HTTPJson(simpleServer::HttpClient &&httpc,
-		const std::string_view &baseUrl)
-:httpc(std::move(httpc)),baseUrl(baseUrl)
+		const std::string_view &baseUrl, const std::string_view &templateKey)
+:httpc(std::move(httpc))
+,templId(HttpClientPool::templateId(std::string(templateKey)+":"+std::to_string(connectTimeout)+":"+std::to_string(ioTimeout)))
+,baseUrl(baseUrl)
 {
-	httpc.setConnectTimeout(5000);
-	httpc.setIOTimeout(10000);
+	this->httpc.setConnectTimeout(connectTimeout);
+	this->httpc.setIOTimeout(ioTimeout);
 }
 
 
@@ -41,12 +47,12 @@ static simpleServer::SendHeaders hdrs(const json::Value &headers) {
 		}
 
 	}
-	hdr("Connection","close");
+	hdr("Connection","keep-alive");
 	if (!headers["Accept"].defined()) hdr("Accept","application/json");
 	return hdr;
 }
 
-json::Value parseResponse(simpleServer::HttpResponse &resp, json::Value &headers) {
+json::Value parseResponse(simpleServer::HttpResponse &resp, json::Value &headers, bool text) {
 	json::Value r;
 	json::Object hh;
 	StrViewA ctx = resp.getHeaders()["Content-Type"];
@@ -55,8 +61,11 @@ json::Value parseResponse(simpleServer::HttpResponse &resp, json::Value &headers
 		std::transform(k.first.begin(), k.first.end(), std::back_inserter(name), tolower);
 		hh.set(name, k.second);
 	}
-	if (ctx.indexOf("application/json") != ctx.npos) {
-		r = json::Value::parse(resp.getBody());
+	if (!text && ctx.indexOf("application/json") != ctx.npos) {
+		auto s = resp.getBody();
+		r = json::Value::parse(s);
+		//connection is reused, so rest of the body must be read
+		while (!s.read().empty()) {}
 	} else {
 		std::ostringstream buff;
 		auto s = resp.getBody();
@@ -72,27 +81,71 @@ json::Value parseResponse(simpleServer::HttpResponse &resp, json::Value &headers
 }
 
 
+static json::Value sendRequest(HttpClientPool::Connection &conn, const std::string_view &method, const std::string &url,
+		json::Value &headers, const std::string_view &data, unsigned int expectedCode, bool text) {
+	auto resp = conn->request(method, url, hdrs(headers), data);
+	unsigned int st = resp.getStatus();
+	if ((expectedCode && st != expectedCode) || (!expectedCode && st/100 != 2)) {
+		throw HTTPJson::UnknownStatusException(st, resp.getMessage(),resp);
+	}
+	json::Value r = parseResponse(resp, headers, text);
+	conn.done();
+	if (text) logDebug("RECV: $1 bytes", r.getString().length);
+	else logDebug("RECV: $1", r);
+	return r;
+}
+
+json::Value HTTPJson::request(const std::string_view &method, const std::string &url,
+		json::Value &headers, const std::string_view &data, unsigned int expectedCode, bool text) {
+
+	HttpClientPool &pool = HttpClientPool::getInstance();
+	{
+		auto conn = pool.acquire(httpc, templId, url);
+		//connection could be closed by the server while it was idle
+		//repeat only requests, which don't change anything
+		if (!conn.isReused() || method != "GET")
+			return sendRequest(conn, method, url, headers, data, expectedCode, text);
+		try {
+			return sendRequest(conn, method, url, headers, data, expectedCode, text);
+		} catch (const simpleServer::HTTPStatusException &) {
+			throw;
+		} catch (std::exception &e) {
+			logDebug("Reused connection failed - retry: $1 - $2", url, e.what());
+		}
+	}
+	auto conn = pool.acquire(httpc, templId, url);
+	return sendRequest(conn, method, url, headers, data, expectedCode, text);
+}
+
 json::Value HTTPJson::GET(const std::string_view &path, json::Value &&headers, unsigned int expectedCode) {
 	std::string url = baseUrl;
 	url.append(path);
 
 	logDebug("GET $1", url);
 
-	auto resp = httpc.request("GET", url, hdrs(headers));
-	unsigned int st = resp.getStatus();
-	if ((expectedCode && st != expectedCode) || (!expectedCode && st/100 != 2)) {
-		throw UnknownStatusException(st, resp.getMessage(),resp);
-	}
-	json::Value r = parseResponse(resp, headers);
-	logDebug("RECV: $1", r);
-	return r;
+	return request("GET", url, headers, std::string_view(), expectedCode);
 }
 
+json::String HTTPJson::GETText(const std::string_view &path, json::Value &&headers, unsigned int expectedCode) {
+	std::string url = baseUrl;
+	url.append(path);
+
+	logDebug("GET $1", url);
+
+	return request("GET", url, headers, std::string_view(), expectedCode, true).toString();
+}
 
 json::Value HTTPJson::SEND(const std::string_view &path,
 		const std::string_view &method, const json::Value &data,
 		json::Value &&headers,
 		unsigned int expectedCode) {
+	return send(path, method, data, headers, expectedCode, false);
+}
+
+json::Value HTTPJson::send(const std::string_view &path,
+		const std::string_view &method, const json::Value &data,
+		json::Value &headers,
+		unsigned int expectedCode, bool text) {
 
 	std::string url = baseUrl;
 	url.append(path);
@@ -108,15 +161,7 @@ json::Value HTTPJson::SEND(const std::string_view &path,
 
 	logDebug("$1 $2 - data $3", method, url, data);
 
-
-	auto resp = httpc.request(method, url, hdrs(headers), sdata.str());
-	unsigned int st = resp.getStatus();
-	if ((expectedCode && st != expectedCode) || (!expectedCode && st/100 != 2)) {
-		throw UnknownStatusException(st, resp.getMessage(), resp);
-	}
-	json::Value r = parseResponse(resp, headers);
-	logDebug("RECV: $1", r);
-	return r;
+	return request(method, url, headers, sdata.str(), expectedCode, text);
 
 }
 
@@ -125,6 +170,11 @@ json::Value HTTPJson::POST(const std::string_view &path,
 	return SEND(path, "POST", data, std::move(headers), expectedCode);
 }
 
+json::String HTTPJson::POSTText(const std::string_view &path,
+		const json::Value &data, json::Value &&headers, unsigned int expectedCode) {
+	return send(path, "POST", data, headers, expectedCode, true).toString();
+}
+
 json::Value HTTPJson::PUT(const std::string_view &path, const json::Value &data,
 		json::Value &&headers, unsigned int expectedCode) {
 	return SEND(path, "PUT", data, std::move(headers), expectedCode);
@@ -9,6 +9,7 @@
 #define SRC_SIMPLEFX_HTTPJSON_H_
 
 #include <string_view>
+#include <imtjson/string.h>
 #include <imtjson/value.h>
 #include <simpleServer/http_client.h>
 
@@ -16,7 +17,15 @@
 class HTTPJson {
 public:
 
-	HTTPJson(simpleServer::HttpClient &&httpc, const std::string_view &baseUrl);
+	///Constructs client
+	/**
+	 * @param httpc template of connections
+	 * @param baseUrl base url
+	 * @param templateKey clients with the same key share keep-alive connections to the same
+	 * host (HttpClientPool). Use different key, when the client is created with different
+	 * settings (user agent, proxy, https provider) than other clients of the process
+	 */
+	HTTPJson(simpleServer::HttpClient &&httpc, const std::string_view &baseUrl, const std::string_view &templateKey = std::string_view());
 	void setToken(const std::string_view &token);
 
 
@@ -24,6 +33,12 @@ public:
 			json::Value &&headers = json::Value(),
 			unsigned int expectedCode = 0);
 
+	///GET request, returns the body as text without parsing
+	/** Use it with JsonReader for large responses */
+	json::String GETText(const std::string_view &path,
+			json::Value &&headers = json::Value(),
+			unsigned int expectedCode = 0);
+
 	json::Value SEND(const std::string_view &path,
 					const std::string_view &method,
 					const json::Value &data,
@@ -35,6 +50,13 @@ public:
 			json::Value &&headers = json::Value(),
 			unsigned int expectedCode = 0);
 
+	///POST request, returns the body as text without parsing
+	/** Use it with JsonReader for large responses */
+	json::String POSTText(const std::string_view &path,
+			const json::Value &data,
+			json::Value &&headers = json::Value(),
+			unsigned int expectedCode = 0);
+
 	json::Value PUT(const std::string_view &path,
 			const json::Value &data,
 			json::Value &&headers = json::Value(),
@@ -60,9 +82,17 @@ public:
 	void setBaseUrl(const std::string &url);
 
 protected:
+	///Template of connections in the pool (HttpClientPool)
 	simpleServer::HttpClient httpc;
+	///Identifies connections created from this template in the pool
+	std::uint64_t templId;
 	std::string baseUrl;
 
+	json::Value request(const std::string_view &method, const std::string &url,
+			json::Value &headers, const std::string_view &data, unsigned int expectedCode, bool text = false);
+	json::Value send(const std::string_view &path, const std::string_view &method, const json::Value &data,
+			json::Value &headers, unsigned int expectedCode, bool text);
+
 };
 
 
@@ -0,0 +1,138 @@
+/*
+ * httppool.cpp
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#include "httppool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <stdexcept>
+#include <imtjson/object.h>
+
+HttpClientPool &HttpClientPool::getInstance() {
+	static HttpClientPool pool;
+	return pool;
+}
+
+HttpClientPool::HttpClientPool(const Config &cfg):cfg(cfg) {}
+
+void HttpClientPool::setConfig(const Config &cfg) {
+	std::unique_lock<std::mutex> _(lock);
+	this->cfg = cfg;
+	cond.notify_all();
+}
+
+std::string HttpClientPool::hostFromUrl(const std::string_view &url) {
+	auto p = url.find("://");
+	p = p == url.npos?0:p+3;
+	auto e = url.find('/', p);
+	return std::string(url.substr(0, e));
+}
+
+std::uint64_t HttpClientPool::now() {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::uint64_t HttpClientPool::templateId(const std::string &key) {
+	static std::mutex idlock;
+	static std::unordered_map<std::string, std::uint64_t> ids;
+	std::unique_lock<std::mutex> _(idlock);
+	return ids.emplace(key, ids.size()+1).first->second;
+}
+
+HttpClientPool::Connection HttpClientPool::acquire(const simpleServer::HttpClient &templ, std::uint64_t templId, const std::string_view &url) {
+	std::string host = hostFromUrl(url);
+	std::unique_lock<std::mutex> _(lock);
+	Host &h = hosts[host];
+	if (!cond.wait_for(_, std::chrono::milliseconds(cfg.acquireTimeout), [&]{return h.active < cfg.maxPerHost;})) {
+		throw std::runtime_error("Too many pending requests to: " + host);
+	}
+	reap(h, now());
+	h.active++;
+	//most recently used connection is the least likely closed by the server
+	auto iter = std::find_if(h.idle.rbegin(), h.idle.rend(), [&](const Idle &x) {
+		return x.templId == templId;
+	});
+	if (iter != h.idle.rend()) {
+		auto client = std::move(iter->client);
+		h.idle.erase(std::next(iter).base());
+		h.reused++;
+		return Connection(*this, std::move(host), templId, std::move(client), true);
+	} else {
+		h.created++;
+		_.unlock();
+		return Connection(*this, std::move(host), templId, std::make_unique<simpleServer::HttpClient>(templ), false);
+	}
+}
+
+void HttpClientPool::release(const std::string &host, std::uint64_t templId, std::unique_ptr<simpleServer::HttpClient> &&client, bool reusable, std::uint64_t latency) {
+	std::unique_lock<std::mutex> _(lock);
+	Host &h = hosts[host];
+	std::uint64_t n = now();
+	h.active--;
+	h.requests++;
+	if (!reusable) h.errors++;
+	h.latencySum += latency;
+	auto bucket = std::lower_bound(histBounds.begin(), histBounds.end(), latency) - histBounds.begin();
+	h.hist[bucket]++;
+	reap(h, n);
+	if (reusable) {
+		//the oldest connection makes room
+		if (h.idle.size() >= cfg.maxIdle && !h.idle.empty()) h.idle.erase(h.idle.begin());
+		if (cfg.maxIdle) h.idle.push_back(Idle{std::move(client), n, templId});
+	}
+	cond.notify_all();
+}
+
+void HttpClientPool::reap(Host &h, std::uint64_t now) {
+	h.idle.erase(std::remove_if(h.idle.begin(), h.idle.end(), [&](const Idle &x) {
+		return x.lastUse + cfg.idleTimeout < now;
+	}), h.idle.end());
+}
+
+void HttpClientPool::clear() {
+	std::unique_lock<std::mutex> _(lock);
+	for (auto &&h: hosts) h.second.idle.clear();
+}
+
+json::Value HttpClientPool::getMetrics() const {
+	std::unique_lock<std::mutex> _(lock);
+	json::Object res;
+	for (auto &&h: hosts) {
+		const Host &hs = h.second;
+		json::Object hist;
+		for (std::size_t i = 0; i < histBounds.size(); i++) {
+			hist.set(std::to_string(histBounds[i]), hs.hist[i]);
+		}
+		hist.set("inf", hs.hist[histBounds.size()]);
+		res.set(h.first, json::Object
+				("active", hs.active)
+				("idle", hs.idle.size())
+				("created", hs.created)
+				("reused", hs.reused)
+				("requests", hs.requests)
+				("errors", hs.errors)
+				("avg_latency_ms", hs.requests?hs.latencySum/hs.requests:0)
+				("latency_ms", hist));
+	}
+	return res;
+}
+
+HttpClientPool::Connection::Connection(HttpClientPool &owner, std::string &&host, std::uint64_t templId, std::unique_ptr<simpleServer::HttpClient> &&client, bool reused)
+	:owner(&owner),host(std::move(host)),templId(templId),client(std::move(client)),reused(reused),start(HttpClientPool::now())
+{
+}
+
+HttpClientPool::Connection::Connection(Connection &&other)
+	:owner(other.owner),host(std::move(other.host)),templId(other.templId),client(std::move(other.client)),reused(other.reused),ok(other.ok),start(other.start)
+{
+	other.owner = nullptr;
+}
+
+HttpClientPool::Connection::~Connection() {
+	if (owner) owner->release(host, templId, std::move(client), ok, HttpClientPool::now() - start);
+}
@@ -0,0 +1,151 @@
+/*
+ * httppool.h
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#ifndef SRC_BROKERS_HTTPPOOL_H_
+#define SRC_BROKERS_HTTPPOOL_H_
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <imtjson/value.h>
+#include <simpleServer/http_client.h>
+
+///Pool of persistent (keep-alive) http connections
+/**
+ * Connections are kept per host (scheme://host:port) and they are shared by
+ * all clients in the broker process, including subaccounts. Number of concurrent
+ * requests to the single host is limited, connections idle for a long time are
+ * dropped, because servers usually close them anyway.
+ *
+ * Each connection is represented by own HttpClient, which keeps its
+ * connection opened between requests. The client is copy of the template (user agent,
+ * timeouts, proxy, https provider), so the idle connection is reused only by clients
+ * with the same template key (see templateId()). Clients created with the same settings
+ * (for example the same client in each subaccount) share the key and the connections
+ */
+class HttpClientPool {
+public:
+
+	struct Config {
+		///maximum concurrent requests per host
+		unsigned int maxPerHost = 4;
+		///maximum count of idle connections per host
+		unsigned int maxIdle = 4;
+		///connection idle longer than this (milliseconds) is closed
+		unsigned int idleTimeout = 20000;
+		///maximum time (milliseconds) to wait for free slot of the host
+		unsigned int acquireTimeout = 30000;
+	};
+
+	class Connection;
+
+	///Retrieves pool shared in the process
+	static HttpClientPool &getInstance();
+
+	HttpClientPool(const Config &cfg = Config());
+
+	///Acquires connection for the url
+	/**
+	 * Blocks while the limit of concurrent requests for the host is reached. Throws
+	 * exception, when no slot is released within acquireTimeout
+	 *
+	 * @param templ http client used as template for a new connection
+	 * @param templId identifier of the template (see templateId())
+	 * @param url url of the request
+	 * @return connection
+	 */
+	Connection acquire(const simpleServer::HttpClient &templ, std::uint64_t templId, const std::string_view &url);
+
+	///Retrieves identifier of the template of connections
+	/**
+	 * @param key describes settings of the template, which affect the connection. Templates
+	 * with the same key receive the same identifier
+	 * @return identifier of the template
+	 */
+	static std::uint64_t templateId(const std::string &key);
+
+	///Retrieves statistics and latency histograms per host
+	json::Value getMetrics() const;
+
+	void setConfig(const Config &cfg);
+
+	///Closes all idle connections
+	void clear();
+
+	static std::string hostFromUrl(const std::string_view &url);
+
+protected:
+
+	///Upper bounds of latency histogram buckets in milliseconds, last bucket is unbounded
+	static constexpr std::array<unsigned int, 10> histBounds = {10,25,50,100,250,500,1000,2500,5000,10000};
+
+	struct Idle {
+		std::unique_ptr<simpleServer::HttpClient> client;
+		std::uint64_t lastUse;
+		std::uint64_t templId;
+	};
+
+	struct Host {
+		std::vector<Idle> idle;
+		unsigned int active = 0;
+		std::uint64_t created = 0;
+		std::uint64_t reused = 0;
+		std::uint64_t requests = 0;
+		std::uint64_t errors = 0;
+		std::uint64_t latencySum = 0;
+		std::array<std::uint64_t, histBounds.size()+1> hist = {};
+	};
+
+	Config cfg;
+	mutable std::mutex lock;
+	std::condition_variable cond;
+	std::unordered_map<std::string, Host> hosts;
+
+	void release(const std::string &host, std::uint64_t templId, std::unique_ptr<simpleServer::HttpClient> &&client, bool reusable, std::uint64_t latency);
+	void reap(Host &h, std::uint64_t now);
+
+	static std::uint64_t now();
+
+public:
+
+	///Leased connection
+	/** When destroyed, the connection is returned to the pool if done() has been called,
+	 * otherwise it is closed (response was not fully read, or error)
+	 */
+	class Connection {
+	public:
+		Connection(HttpClientPool &owner, std::string &&host, std::uint64_t templId, std::unique_ptr<simpleServer::HttpClient> &&client, bool reused);
+		Connection(Connection &&other);
+		~Connection();
+
+		simpleServer::HttpClient &operator*() const {return *client;}
+		simpleServer::HttpClient *operator->() const {return client.get();}
+
+		///Connection was already used by other request
+		bool isReused() const {return reused;}
+		///Request finished and response has been read completely
+		void done() {ok = true;}
+		///Request failed
+		void failed() {ok = false;}
+
+	protected:
+		HttpClientPool *owner;
+		std::string host;
+		std::uint64_t templId;
+		std::unique_ptr<simpleServer::HttpClient> client;
+		bool reused;
+		bool ok = false;
+		std::uint64_t start;
+	};
+
+};
+
+#endif /* SRC_BROKERS_HTTPPOOL_H_ */
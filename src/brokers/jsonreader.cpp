@@ -0,0 +1,174 @@
+/*
+ * jsonreader.cpp
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#include "jsonreader.h"
+
+#include <charconv>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+void JsonReader::error() const {
+	throw std::runtime_error("JSON: unexpected character at position " + std::to_string(pos));
+}
+
+char JsonReader::skipWs() {
+	while (pos < text.size()) {
+		char c = text[pos];
+		if (c != ' ' && c != '\t' && c != '\r' && c != '\n') return c;
+		pos++;
+	}
+	return 0;
+}
+
+void JsonReader::expect(char c) {
+	if (skipWs() != c) error();
+	pos++;
+}
+
+JsonReader::Type JsonReader::peek() {
+	switch (skipWs()) {
+		case 0: return Type::end;
+		case '{': return Type::object;
+		case '[': return Type::array;
+		case '"': return Type::string;
+		case 't':
+		case 'f': return Type::boolean;
+		case 'n': return Type::null;
+		default: return Type::number;
+	}
+}
+
+bool JsonReader::openObject() {
+	if (skipWs() != '{') return false;
+	pos++;
+	return true;
+}
+
+bool JsonReader::openArray() {
+	if (skipWs() != '[') return false;
+	pos++;
+	return true;
+}
+
+bool JsonReader::nextKey(std::string_view &key) {
+	char c = skipWs();
+	if (c == '}') {
+		pos++;
+		return false;
+	}
+	if (c == ',') {
+		pos++;
+		c = skipWs();
+	}
+	if (c != '"') error();
+	key = readString();
+	expect(':');
+	return true;
+}
+
+bool JsonReader::nextItem() {
+	char c = skipWs();
+	if (c == ']') {
+		pos++;
+		return false;
+	}
+	if (c == ',') {
+		pos++;
+		if (skipWs() == 0) error();
+	} else if (c == 0) {
+		error();
+	}
+	return true;
+}
+
+bool JsonReader::find(std::string_view key) {
+	std::string_view k;
+	while (nextKey(k)) {
+		if (k == key) return true;
+		skip();
+	}
+	return false;
+}
+
+std::string_view JsonReader::readString() {
+	//at opening quote
+	std::size_t start = ++pos;
+	while (pos < text.size()) {
+		char c = text[pos];
+		if (c == '\\') pos+=2;
+		else if (c == '"') return text.substr(start, pos++ - start);
+		else pos++;
+	}
+	error();
+}
+
+std::string_view JsonReader::readRaw() {
+	char c = skipWs();
+	if (c == '"') return readString();
+	std::size_t start = pos;
+	skip();
+	return text.substr(start, pos - start);
+}
+
+void JsonReader::skip() {
+	char c = skipWs();
+	if (c == '"') {
+		readString();
+	} else if (c == '{' || c == '[') {
+		unsigned int depth = 0;
+		while (pos < text.size()) {
+			c = text[pos];
+			if (c == '"') {
+				readString();
+				continue;
+			}
+			pos++;
+			if (c == '{' || c == '[') depth++;
+			else if ((c == '}' || c == ']') && --depth == 0) return;
+		}
+		error();
+	} else if (c == 0) {
+		error();
+	} else {
+		//number or literal
+		while (pos < text.size()) {
+			c = text[pos];
+			if (c == ',' || c == ']' || c == '}' || c == ' ' || c == '\t' || c == '\r' || c == '\n') break;
+			pos++;
+		}
+	}
+}
+
+double JsonReader::toNumber(std::string_view text) {
+	double res = 0;
+	if (!text.empty() && text[0] == '+') text = text.substr(1);
+	auto r = std::from_chars(text.data(), text.data()+text.size(), res);
+	if (r.ec != std::errc()) return 0;
+	return res;
+}
+
+double JsonReader::requireNumber(std::string_view text) {
+	std::string_view t = text;
+	if (!t.empty() && t[0] == '+') t = t.substr(1);
+	double res = 0;
+	auto r = std::from_chars(t.data(), t.data()+t.size(), res);
+	if (t.empty() || r.ec != std::errc() || r.ptr != t.data()+t.size() || !std::isfinite(res)) {
+		throw std::runtime_error("JSON: invalid number '" + std::string(text) + "'");
+	}
+	return res;
+}
+
+std::uint64_t JsonReader::toUInt(std::string_view text) {
+	std::uint64_t res = 0;
+	auto r = std::from_chars(text.data(), text.data()+text.size(), res);
+	if (r.ec != std::errc() || r.ptr != text.data()+text.size()) {
+		//could be a number with a decimal point or an exponent
+		double d = toNumber(text);
+		return d > 0?static_cast<std::uint64_t>(d):0;
+	}
+	return res;
+}
@@ -0,0 +1,217 @@
+/*
+ * jsonreader.h
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#ifndef SRC_BROKERS_JSONREADER_H_
+#define SRC_BROKERS_JSONREADER_H_
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <string_view>
+#include "../main/istockapi.h"
+
+///Reads selected fields from JSON text without building json::Value
+/**
+ * The reader walks the text and the caller picks only what it needs, everything
+ * else is skipped without allocation. Values are returned as views to the text. Strings
+ * are returned without quotes and escape sequences are not processed, which
+ * is enough for symbols, numbers and identifiers.
+ *
+ * Use it for large responses (tickers of all markets, long trade history) where
+ * only few fields of few items are needed. Text must stay valid while the reader is used
+ */
+class JsonReader {
+public:
+
+	enum class Type {
+		object,
+		array,
+		string,
+		number,
+		boolean,
+		null,
+		end
+	};
+
+	JsonReader(std::string_view text):text(text) {}
+
+	///Type of the next value
+	Type peek();
+	///Enters the object, returns false when next value is not an object
+	bool openObject();
+	///Enters the array, returns false when next value is not an array
+	bool openArray();
+	///Reads next key of the object
+	/**
+	 * @param key receives the key, the value follows and must be read or skipped
+	 * @retval true key read
+	 * @retval false end of the object
+	 */
+	bool nextKey(std::string_view &key);
+	///Moves to the next item of the array
+	/**
+	 * @retval true item follows and must be read or skipped
+	 * @retval false end of the array
+	 */
+	bool nextItem();
+	///Finds the key in the current object
+	/**
+	 * @retval true found, the value follows
+	 * @retval false not found, the object has been read to the end
+	 */
+	bool find(std::string_view key);
+	///Reads the value as text (string without quotes, whole text of the object or the array)
+	std::string_view readRaw();
+	///Skips the value
+	void skip();
+
+	///Calls the function for every object of the current array (array must be opened)
+	/**
+	 * @param fields names of the fields to extract
+	 * @param fn function receives values of the fields in the same order, missing
+	 * fields are empty
+	 */
+	template<std::size_t N, typename Fn>
+	void forEachObject(const std::array<std::string_view, N> &fields, Fn &&fn);
+	///Calls the function for every array of the current array (array must be opened)
+	/**
+	 * @tparam N count of leading items to extract
+	 * @param fn function receives the first N items of the array, missing items are empty
+	 */
+	template<std::size_t N, typename Fn>
+	void forEachArray(Fn &&fn);
+
+	///Converts text to the number, numbers in strings are accepted. Invalid number is 0
+	static double toNumber(std::string_view text);
+	///Converts text to the number, numbers in strings are accepted
+	/** Use it for prices and sizes. Throws exception when the field is missing or the number is invalid */
+	static double requireNumber(std::string_view text);
+	///Converts text to the unsigned number. Invalid number is 0
+	static std::uint64_t toUInt(std::string_view text);
+
+protected:
+	std::string_view text;
+	std::size_t pos = 0;
+
+	char skipWs();
+	void expect(char c);
+	std::string_view readString();
+	[[noreturn]] void error() const;
+};
+
+template<std::size_t N, typename Fn>
+inline void JsonReader::forEachObject(const std::array<std::string_view, N> &fields, Fn &&fn) {
+	std::array<std::string_view, N> values;
+	while (nextItem()) {
+		if (!openObject()) {
+			skip();
+			continue;
+		}
+		values.fill(std::string_view());
+		std::string_view key;
+		while (nextKey(key)) {
+			std::size_t i = 0;
+			while (i < N && fields[i] != key) i++;
+			if (i < N) values[i] = readRaw();
+			else skip();
+		}
+		fn(values);
+	}
+}
+
+template<std::size_t N, typename Fn>
+inline void JsonReader::forEachArray(Fn &&fn) {
+	std::array<std::string_view, N> values;
+	while (nextItem()) {
+		if (!openArray()) {
+			skip();
+			continue;
+		}
+		values.fill(std::string_view());
+		std::size_t i = 0;
+		while (nextItem()) {
+			if (i < N) values[i] = readRaw();
+			else skip();
+			i++;
+		}
+		fn(values);
+	}
+}
+
+///Names of the fields of the ticker
+struct JsonTickerFields {
+	std::string_view symbol;
+	std::string_view bid;
+	std::string_view ask;
+	///can be empty, mid price is used then
+	std::string_view last;
+};
+
+///Reads tickers of the requested symbols from the array of objects (for example book ticker of all markets)
+/**
+ * @param rd reader positioned at the array
+ * @param fields names of the fields
+ * @param time time stored to the tickers
+ * @param accept function receives symbol and returns pointer to the ticker to fill,
+ * or nullptr to skip the symbol. Numbers of skipped symbols are not parsed
+ *
+ * Throws exception, when a price of the accepted symbol is missing or invalid
+ */
+template<typename Fn>
+inline void readTickers(JsonReader &rd, const JsonTickerFields &fields, std::uint64_t time, Fn &&accept) {
+	if (!rd.openArray()) return;
+	rd.forEachObject(std::array<std::string_view,4>{fields.symbol, fields.bid, fields.ask, fields.last},
+			[&](const std::array<std::string_view,4> &v) {
+		IStockApi::Ticker *tk = accept(v[0]);
+		if (tk == nullptr) return;
+		tk->bid = JsonReader::requireNumber(v[1]);
+		tk->ask = JsonReader::requireNumber(v[2]);
+		tk->last = v[3].empty()?(tk->bid+tk->ask)*0.5:JsonReader::requireNumber(v[3]);
+		tk->time = time;
+	});
+}
+
+///Names of the fields of the trade
+struct JsonTradeFields {
+	///identifier, it is always stored as string
+	std::string_view id;
+	///time in milliseconds
+	std::string_view time;
+	std::string_view size;
+	std::string_view price;
+	///can be empty, sign of the size is used then
+	std::string_view side;
+	///value of the side field of the sell trade
+	std::string_view sellValue = "sell";
+};
+
+///Reads trades from the array of objects
+/**
+ * @param rd reader positioned at the array
+ * @param fields names of the fields
+ * @param fn function receives the trade. Effective size and price are same as size and price,
+ * fees must be applied by the caller
+ *
+ * Throws exception, when size or price is missing or invalid
+ */
+template<typename Fn>
+inline void readTrades(JsonReader &rd, const JsonTradeFields &fields, Fn &&fn) {
+	if (!rd.openArray()) return;
+	rd.forEachObject(std::array<std::string_view,5>{fields.id, fields.time, fields.size, fields.price, fields.side},
+			[&](const std::array<std::string_view,5> &v) {
+		double size = JsonReader::requireNumber(v[2]);
+		if (!fields.side.empty()) {
+			size = std::abs(size);
+			if (v[4] == fields.sellValue) size = -size;
+		}
+		double price = JsonReader::requireNumber(v[3]);
+		fn(IStockApi::Trade{json::Value(json::StrViewA(v[0].data(), v[0].length())),
+			JsonReader::toUInt(v[1]), size, price, size, price});
+	});
+}
+
+
+#endif /* SRC_BROKERS_JSONREADER_H_ */
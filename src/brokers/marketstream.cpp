@@ -0,0 +1,225 @@
+/*
+ * marketstream.cpp
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#include "marketstream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <imtjson/object.h>
+#include "../shared/logOutput.h"
+#include "api.h"
+
+using ondra_shared::logDebug;
+using ondra_shared::logError;
+using ondra_shared::logWarning;
+
+MarketDataStream::MarketDataStream(simpleServer::HttpClient &&httpc, std::unique_ptr<IProtocol> &&protocol, unsigned int maxAge)
+	:httpc(std::move(httpc)),protocol(std::move(protocol)),maxAge(maxAge)
+{
+}
+
+MarketDataStream::~MarketDataStream() {
+	Sync _(lock);
+	stopped = true;
+	stopCond.notify_all();
+	if (ws != nullptr) ws.close();
+	_.unlock();
+	if (thr.joinable()) thr.join();
+}
+
+std::uint64_t MarketDataStream::now() {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+MarketDataStream::PairData &MarketDataStream::getPair(const std::string_view &pair) {
+	return pairs[std::string(pair)];
+}
+
+void MarketDataStream::subscribe(const std::string_view &pair) {
+	Sync _(lock);
+	PairData &pd = getPair(pair);
+	if (pd.subscribed) return;
+	pd.subscribed = true;
+	if (!running) {
+		running = true;
+		thr = std::thread([this]{worker();});
+	} else if (connected) {
+		try {
+			protocol->subscribe(ws, std::string(pair));
+		} catch (std::exception &e) {
+			logError("Stream subscribe error: $1 - $2", pair, e.what());
+		}
+	}
+}
+
+std::optional<MarketDataStream::Ticker> MarketDataStream::getTicker(const std::string_view &pair) {
+	Sync _(lock);
+	subscribe(pair);
+	PairData &pd = getPair(pair);
+	if (!connected || !pd.ticker.has_value() || pd.tickerUpdated + maxAge < now()) return {};
+	return pd.ticker;
+}
+
+std::optional<MarketDataStream::Orders> MarketDataStream::getOpenOrders(const std::string_view &pair) {
+	Sync _(lock);
+	subscribe(pair);
+	PairData &pd = getPair(pair);
+	if (!connected || !pd.ordersValid) return {};
+	return pd.orders;
+}
+
+unsigned int MarketDataStream::getOrdersVersion(const std::string_view &pair) {
+	Sync _(lock);
+	return getPair(pair).ordersVersion;
+}
+
+void MarketDataStream::setOrders(const std::string_view &pair, Orders &&orders, unsigned int version) {
+	Sync _(lock);
+	PairData &pd = getPair(pair);
+	if (connected && pd.ordersVersion == version) {
+		pd.orders = std::move(orders);
+		pd.ordersValid = true;
+	}
+}
+
+unsigned int MarketDataStream::getFillsVersion(const std::string_view &pair) {
+	Sync _(lock);
+	return getPair(pair).fillsVersion;
+}
+
+bool MarketDataStream::needSyncTrades(const std::string_view &pair) {
+	Sync _(lock);
+	subscribe(pair);
+	PairData &pd = getPair(pair);
+	return !connected || pd.fillsVersion != pd.fillsSynced;
+}
+
+void MarketDataStream::setTradesSynced(const std::string_view &pair, unsigned int version) {
+	Sync _(lock);
+	getPair(pair).fillsSynced = version;
+}
+
+bool MarketDataStream::isConnected() const {
+	Sync _(lock);
+	return connected;
+}
+
+void MarketDataStream::reconnect() {
+	Sync _(lock);
+	if (ws != nullptr) ws.close();
+}
+
+void MarketDataStream::updateTicker(const std::string_view &pair, const Ticker &tk) {
+	Sync _(lock);
+	PairData &pd = getPair(pair);
+	pd.ticker = tk;
+	pd.tickerUpdated = now();
+}
+
+void MarketDataStream::updateOrder(const std::string_view &pair, const Order &order) {
+	Sync _(lock);
+	PairData &pd = getPair(pair);
+	pd.ordersVersion++;
+	if (!pd.ordersValid) return;
+	auto iter = std::find_if(pd.orders.begin(), pd.orders.end(), [&](const Order &o) {
+		return o.id == order.id;
+	});
+	if (order.size == 0) {
+		if (iter != pd.orders.end()) pd.orders.erase(iter);
+	} else if (iter != pd.orders.end()) {
+		*iter = order;
+	} else {
+		pd.orders.push_back(order);
+	}
+}
+
+void MarketDataStream::invalidateOrders(const std::string_view &pair) {
+	Sync _(lock);
+	PairData &pd = getPair(pair);
+	pd.ordersValid = false;
+	pd.orders.clear();
+	pd.ordersVersion++;
+}
+
+void MarketDataStream::reportFill(const std::string_view &pair) {
+	{
+		Sync _(lock);
+		getPair(pair).fillsVersion++;
+	}
+	AbstractBrokerAPI::sendEvent(json::Object("type","fill")("pair",json::StrViewA(pair.data(), pair.size())));
+}
+
+void MarketDataStream::invalidate() {
+	connected = false;
+	for (auto &&p: pairs) {
+		PairData &pd = p.second;
+		pd.ticker.reset();
+		pd.ordersValid = false;
+		pd.orders.clear();
+		pd.ordersVersion++;
+		//fills could be missed while disconnected
+		pd.fillsVersion++;
+	}
+}
+
+bool MarketDataStream::connect(Sync &lk) {
+	std::string url = protocol->getUrl();
+	logDebug("Opening stream: $1", url);
+	//connecting can take long time, readers of the cache must not wait
+	lk.unlock();
+	simpleServer::WebSocketStream s;
+	try {
+		s = simpleServer::connectWebSocket(httpc, url, simpleServer::SendHeaders());
+		s.getStream().setIOTimeout(protocol->getIOTimeout());
+	} catch (...) {
+		lk.lock();
+		throw;
+	}
+	lk.lock();
+	if (stopped) {
+		s.close();
+		return false;
+	}
+	ws = s;
+	connected = true;
+	for (auto &&p: pairs) {
+		if (p.second.subscribed) protocol->subscribe(ws, p.first);
+	}
+	return true;
+}
+
+void MarketDataStream::worker() {
+	Sync _(lock);
+	while (!stopped) {
+		try {
+			if (!connect(_)) break;
+			simpleServer::WebSocketStream s = ws;
+			_.unlock();
+			try {
+				while (s.readFrame()) {
+					if (s.getFrameType() == simpleServer::WSFrameType::text) {
+						try {
+							protocol->onMessage(*this, json::Value::fromString(s.getText()));
+						} catch (std::exception &e) {
+							logError("Stream message error: $1 (discarded frame: $2)", e.what(), s.getText());
+						}
+					}
+				}
+			} catch (...) {
+				_.lock();
+				throw;
+			}
+			_.lock();
+			if (!stopped) logWarning("Stream closed - reconnect");
+		} catch (std::exception &e) {
+			logError("Stream error: $1 - reconnect", e.what());
+		}
+		invalidate();
+		ws = simpleServer::WebSocketStream();
+		stopCond.wait_for(_, std::chrono::seconds(3), [&]{return stopped;});
+	}
+}
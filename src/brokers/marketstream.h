@@ -0,0 +1,165 @@
+/*
+ * marketstream.h
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#ifndef SRC_BROKERS_MARKETSTREAM_H_
+#define SRC_BROKERS_MARKETSTREAM_H_
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <simpleServer/websockets_stream.h>
+#include <simpleServer/http_client.h>
+
+#include "../main/istockapi.h"
+
+///Keeps market data current from the exchange's websocket stream
+/**
+ * The stream runs own thread, which reads the websocket and updates the cache
+ * through the exchange specific protocol. Broker reads the cache and
+ * uses REST only when cache is not available (not subscribed yet, stream
+ * is disconnected, data are too old). Every reconnect invalidates the cache, so
+ * the broker must resync through REST.
+ *
+ * The stream is connected on the first subscription
+ */
+class MarketDataStream {
+public:
+
+	using Ticker = IStockApi::Ticker;
+	using Order = IStockApi::Order;
+	using Orders = IStockApi::Orders;
+
+	///Exchange specific part of the stream
+	class IProtocol {
+	public:
+		///Retrieves url of the stream. Called on every connect
+		virtual std::string getUrl() = 0;
+		///Sends subscription request for the pair. Called with the stream locked
+		virtual void subscribe(simpleServer::WebSocketStream &ws, const std::string &pair) = 0;
+		///Processes a message from the stream
+		virtual void onMessage(MarketDataStream &stream, json::Value msg) = 0;
+		///IO timeout - stream is reconnected when no data arrives during this period
+		virtual unsigned int getIOTimeout() const {return 30000;}
+		virtual ~IProtocol() {}
+	};
+
+	///Construct stream
+	/**
+	 * @param httpc http client used to open websocket
+	 * @param protocol exchange specific protocol
+	 * @param maxAge maximum age of ticker (in milliseconds) served from the cache
+	 */
+	MarketDataStream(simpleServer::HttpClient &&httpc, std::unique_ptr<IProtocol> &&protocol, unsigned int maxAge = 60000);
+	~MarketDataStream();
+
+	///Subscribes the pair. Starts the stream when it is not running
+	void subscribe(const std::string_view &pair);
+
+	///Retrieves ticker from the cache
+	/** Subscribes the pair if not subscribed yet
+	 * @return ticker if available, otherwise broker must use REST
+	 */
+	std::optional<Ticker> getTicker(const std::string_view &pair);
+
+	///Retrieves open orders from the cache
+	/**
+	 * @param pair pair
+	 * @return orders if available, otherwise broker must use REST and resync the cache
+	 * through the function setOrders()
+	 */
+	std::optional<Orders> getOpenOrders(const std::string_view &pair);
+
+	///Drops cached orders of the pair, next getOpenOrders() must resync through REST
+	/** Call it before the order is placed or canceled, so the cache is not served until
+	 * the stream reports the change
+	 */
+	void invalidateOrders(const std::string_view &pair);
+
+	///Retrieves version of order updates - use it before REST request to resync orders
+	unsigned int getOrdersVersion(const std::string_view &pair);
+
+	///Resyncs orders from REST
+	/**
+	 * @param pair pair
+	 * @param orders orders from REST
+	 * @param version version retrieved before the REST was called. If stream updated
+	 * orders meantime, the snapshot is ignored
+	 */
+	void setOrders(const std::string_view &pair, Orders &&orders, unsigned int version);
+
+	///Retrieves version of fills
+	/** The version increases on every fill. If the version is same as version of
+	 * last synchronization, there are no new trades
+	 */
+	unsigned int getFillsVersion(const std::string_view &pair);
+	///Determines, whether trades must be synced through REST
+	bool needSyncTrades(const std::string_view &pair);
+	///Marks trades synced
+	/**
+	 * @param pair pair
+	 * @param version version retrieved by getFillsVersion before REST was called
+	 */
+	void setTradesSynced(const std::string_view &pair, unsigned int version);
+
+	bool isConnected() const;
+
+	///Closes current connection, the stream reconnects and the cache is invalidated
+	/** It can be called by the protocol, when the exchange reports, that the stream
+	 * is no longer valid
+	 */
+	void reconnect();
+
+	///Called by the protocol - updates ticker
+	void updateTicker(const std::string_view &pair, const Ticker &tk);
+	///Called by the protocol - updates or removes order (zero size removes the order)
+	void updateOrder(const std::string_view &pair, const Order &order);
+	///Called by the protocol - reports new fill, mmbot is notified by an event
+	void reportFill(const std::string_view &pair);
+
+	static std::uint64_t now();
+
+protected:
+
+	struct PairData {
+		std::optional<Ticker> ticker;
+		std::uint64_t tickerUpdated = 0;
+		bool ordersValid = false;
+		Orders orders;
+		unsigned int ordersVersion = 0;
+		unsigned int fillsVersion = 1;
+		unsigned int fillsSynced = 0;
+		bool subscribed = false;
+	};
+
+	simpleServer::HttpClient httpc;
+	std::unique_ptr<IProtocol> protocol;
+	unsigned int maxAge;
+
+	mutable std::recursive_mutex lock;
+	using Sync = std::unique_lock<std::recursive_mutex>;
+	std::condition_variable_any stopCond;
+
+	std::unordered_map<std::string, PairData> pairs;
+	simpleServer::WebSocketStream ws;
+	std::thread thr;
+	bool running = false;
+	bool connected = false;
+	bool stopped = false;
+
+	PairData &getPair(const std::string_view &pair);
+	void worker();
+	///Connects the stream, lock is released while the connection is being opened
+	/** @retval false stream has been stopped meanwhile */
+	bool connect(Sync &lk);
+	void invalidate();
+};
+
+
+
+#endif /* SRC_BROKERS_MARKETSTREAM_H_ */
@@ -7,16 +7,58 @@
 
 #include "orderdatadb.h"
 
+#include <fcntl.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/file.h>
+#include <algorithm>
 #include <cerrno>
 #include <csignal>
+#include <cstdlib>
 #include <cstring>
+#include <fstream>
+#include <mutex>
 using namespace json;
 
-OrderDataDB::OrderDataDB(std::string path, unsigned int maxRows):lock_path(path+"-lock"),maxRows(maxRows) {
+namespace {
+
+///Databases waiting for activation of the standby process
+struct StandbyState {
+	std::mutex lock;
+	bool standby = std::getenv("MMBOT_BROKER_STANDBY") != nullptr;
+	std::vector<OrderDataDB *> waiting;
+};
+
+StandbyState &standbyState() {
+	static StandbyState st;
+	return st;
+}
+
+}
+
+OrderDataDB::OrderDataDB(std::string path, unsigned int maxRows):path(path),lock_path(path+"-lock"),maxRows(maxRows) {
+	StandbyState &st = standbyState();
+	std::unique_lock _(st.lock);
+	if (st.standby) st.waiting.push_back(this);
+	else open();
+}
+
+void OrderDataDB::activate() {
+	StandbyState &st = standbyState();
+	std::unique_lock _(st.lock);
+	st.standby = false;
+	while (!st.waiting.empty()) {
+		st.waiting.back()->open();
+		st.waiting.pop_back();
+	}
+}
+
+void OrderDataDB::checkOpened() const {
+	if (!opened) throw std::runtime_error("Order database is not open - the broker is in standby");
+}
+
+void OrderDataDB::open() {
 	lockfile = ::open(lock_path.c_str(),O_TRUNC|O_CREAT|O_RDWR, 0666);
 	if (lockfile == -1) {
 		throw std::runtime_error("Unable to open: " + lock_path + " - " + strerror(errno));
@@ -24,50 +66,68 @@ OrderDataDB::OrderDataDB(std::string path, unsigned int maxRows):lock_path(path+
 	int r = ::flock(lockfile, LOCK_EX|LOCK_NB);
 	if (r == -1) {
 		close(lockfile);
+		lockfile = -1;
 		throw std::runtime_error("Unable to lock: " + lock_path + " - The database file is locked");
 	}
+	logFile = path+"-log";
+	compactFile = path+"-compact";
 	backFile = path+"-back";
 	frontFile = path+"-front";
-	load(backFile);
-	curRows = load(frontFile);
+	//unfinished compaction
+	unlink(compactFile.c_str());
+	loadLog();
+	if (access(backFile.c_str(), F_OK) == 0 || access(frontFile.c_str(), F_OK) == 0) {
+		//convert database of the previous version
+		importLegacy(backFile);
+		importLegacy(frontFile);
+		Snapshot snapshot;
+		for (auto &&x: index) snapshot.emplace_back(x.first, x.second.data);
+		if (writeSnapshot(compactFile, snapshot) && rename(compactFile.c_str(), logFile.c_str()) == 0) {
+			unlink(backFile.c_str());
+			unlink(frontFile.c_str());
+		}
+	}
+	openLog();
+	opened = true;
 }
 
 OrderDataDB::~OrderDataDB() {
+	if (!opened) {
+		StandbyState &st = standbyState();
+		std::unique_lock _(st.lock);
+		st.waiting.erase(std::remove(st.waiting.begin(), st.waiting.end(), this), st.waiting.end());
+		//activation could fail after the lock was acquired
+		if (lockfile != -1) close(lockfile);
+		return;
+	}
+	finishCompaction(true);
+	if (logfd != -1) close(logfd);
 	close(lockfile);
 	remove(lock_path.c_str());
 }
 
-
-bool eatWhite(std::ifstream &in) {
-	int k = in.get();
-	while (k!= EOF && std::isspace(k) ) {
-		k  = in.get();
+void OrderDataDB::openLog() {
+	logfd = ::open(logFile.c_str(), O_WRONLY|O_CREAT|O_APPEND|O_CLOEXEC, 0666);
+	if (logfd == -1) {
+		throw std::runtime_error("Unable to open: " + logFile + " - " + strerror(errno));
 	}
-	if (k == EOF) return false;
-	in.putback(k);
-	return true;
 }
 
-
 void OrderDataDB::store(json::Value orderId, json::Value data) {
-	curMap[orderId] = data;
-	mark(orderId);
+	checkOpened();
+	finishCompaction(false);
+	index[orderId] = Entry{data, curGen};
+	append(orderId, data);
 }
 
 bool OrderDataDB::mark(json::Value orderId) {
-	auto iter = curMap.find(orderId);
-	if (iter != curMap.end()) {
-		std::ofstream f(frontFile, std::ios::app);
-		Value({iter->first, iter->second}).toStream(f);
-		f<<std::endl;
-		curRows++;
-		if (curRows >= maxRows) {
-			curMap.clear();
-			load(backFile);
-			load(frontFile);
-			rename(frontFile.c_str(), backFile.c_str());
-			curRows = 0;
-		}
+	checkOpened();
+	finishCompaction(false);
+	auto iter = index.find(orderId);
+	if (iter != index.end()) {
+		//data are not changed, so only generation is updated, no write is needed
+		iter->second.gen = curGen;
+		if (++curRows >= maxRows) rotate();
 		return true;
 	} else {
 		return false;
@@ -75,21 +135,156 @@ bool OrderDataDB::mark(json::Value orderId) {
 }
 
 json::Value OrderDataDB::get( json::Value orderId) {
-	auto iter = curMap.find(orderId);
-	if (iter != curMap.end()) return iter->second;
+	checkOpened();
+	auto iter = index.find(orderId);
+	if (iter != index.end()) return iter->second.data;
 	else return Value();
 
 }
 
-unsigned int OrderDataDB::load(const std::string &file) {
+void OrderDataDB::encode(std::string &out, const json::Value &orderId, const json::Value &data) {
+	std::size_t lenpos = out.size();
+	out.append(4, '\0');
+	Value({orderId, data}).serializeBinary([&](char c){out.push_back(c);});
+	std::uint32_t len = static_cast<std::uint32_t>(out.size() - lenpos - 4);
+	for (int i = 0; i < 4; i++) out[lenpos+i] = static_cast<char>((len >> (8*i)) & 0xFF);
+}
+
+void OrderDataDB::writeAll(int fd, const std::string &data) {
+	std::size_t pos = 0;
+	while (pos < data.size()) {
+		ssize_t r = ::write(fd, data.data()+pos, data.size()-pos);
+		if (r == -1) {
+			if (errno == EINTR) continue;
+			throw std::runtime_error(std::string("Unable to write order database: ") + strerror(errno));
+		}
+		pos += r;
+	}
+}
+
+void OrderDataDB::append(const json::Value &orderId, const json::Value &data) {
+	std::string rec;
+	encode(rec, orderId, data);
+	writeAll(logfd, rec);
+	if (compacting) pending.append(rec);
+	if (++curRows >= maxRows) rotate();
+}
+
+void OrderDataDB::rotate() {
+	curRows = 0;
+	curGen++;
+	//keep current and two previous generations
+	for (auto iter = index.begin(); iter != index.end();) {
+		if (iter->second.gen + 2 < curGen) iter = index.erase(iter);
+		else ++iter;
+	}
+	//still compacting, next rotation compacts again
+	if (compacting) return;
+
+	Snapshot snapshot;
+	snapshot.reserve(index.size());
+	for (auto &&x: index) snapshot.emplace_back(x.first, x.second.data);
+	compacting = true;
+	compactDone = false;
+	compactThr = std::thread([this, snapshot = std::move(snapshot)]{
+		compactFailed = !writeSnapshot(compactFile, snapshot);
+		compactDone = true;
+	});
+}
+
+bool OrderDataDB::writeSnapshot(const std::string &file, const Snapshot &snapshot) {
+	int fd = ::open(file.c_str(), O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0666);
+	if (fd == -1) return false;
+	try {
+		std::string buff;
+		for (auto &&x: snapshot) {
+			encode(buff, x.first, x.second);
+			if (buff.size() >= 65536) {
+				writeAll(fd, buff);
+				buff.clear();
+			}
+		}
+		writeAll(fd, buff);
+		fsync(fd);
+	} catch (...) {
+		close(fd);
+		return false;
+	}
+	close(fd);
+	return true;
+}
+
+void OrderDataDB::finishCompaction(bool wait) {
+	if (!compacting || (!wait && !compactDone)) return;
+	compactThr.join();
+	compacting = false;
+	std::string p = std::move(pending);
+	pending.clear();
+	if (!compactFailed) {
+		int fd = ::open(compactFile.c_str(), O_WRONLY|O_APPEND|O_CLOEXEC);
+		if (fd != -1) {
+			try {
+				//records written meantime
+				writeAll(fd, p);
+				fsync(fd);
+				if (rename(compactFile.c_str(), logFile.c_str()) == 0) {
+					close(logfd);
+					logfd = fd;
+					return;
+				}
+			} catch (...) {
+
+			}
+			close(fd);
+		}
+	}
+	//keep old log, it is still valid
+	unlink(compactFile.c_str());
+}
+
+void OrderDataDB::loadLog() {
+	int fd = ::open(logFile.c_str(), O_RDONLY|O_CLOEXEC);
+	if (fd == -1) return;
+	std::string buf;
+	char tmp[65536];
+	ssize_t r;
+	while ((r = ::read(fd, tmp, sizeof(tmp))) > 0) buf.append(tmp, r);
+	close(fd);
+
+	std::size_t pos = 0;
+	while (pos + 4 <= buf.size()) {
+		std::uint32_t len = 0;
+		for (int i = 0; i < 4; i++) len |= static_cast<std::uint32_t>(static_cast<unsigned char>(buf[pos+i])) << (8*i);
+		std::size_t p = pos + 4;
+		std::size_t e = p + len;
+		if (e > buf.size()) break;
+		try {
+			Value rec = Value::parseBinary([&]{
+				if (p >= e) throw std::runtime_error("Truncated record");
+				return static_cast<int>(static_cast<unsigned char>(buf[p++]));
+			}, base64);
+			index[rec[0]] = Entry{rec[1], curGen};
+			curRows++;
+		} catch (...) {
+			//skip damaged record
+		}
+		pos = e;
+	}
+	//incomplete record at the end - crash while writing
+	if (pos < buf.size()) {
+		if (truncate(logFile.c_str(), pos) == -1) {
+			throw std::runtime_error("Unable to repair: " + logFile + " - " + strerror(errno));
+		}
+	}
+}
+
+void OrderDataDB::importLegacy(const std::string &file) {
 	std::ifstream in(file);
-	if (!in) return 0;
-	unsigned int cnt = 0;
+	if (!in) return;
 	while (!!in) {
 		try {
 			json::Value p = json::Value::fromStream(in);
-			curMap[p[0]] = p[1];
-			cnt++;
+			index[p[0]] = Entry{p[1], curGen};
 		} catch (...) {
 
 		}
@@ -98,5 +293,4 @@ unsigned int OrderDataDB::load(const std::string &file) {
 		if (c == EOF) break;
 		in.putback(static_cast<char>(c));
 	}
-	return cnt;
 }
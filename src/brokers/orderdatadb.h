@@ -7,11 +7,28 @@
 
 #ifndef SRC_POLONIEX_ORDERDATADB_H_
 #define SRC_POLONIEX_ORDERDATADB_H_
+#include <atomic>
 #include <string>
-#include <fstream>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 #include <imtjson/value.h>
 
+///Stores data associated with orders
+/**
+ * Records are appended to the log file in compact binary format
+ * (length + binary json). All live records are indexed in the memory.
+ *
+ * Records, which are not stored or marked during current and two previous
+ * generations (a generation has maxRows stores and marks) are forgotten. Mark doesn't
+ * write anything. After each generation, the log is compacted on the background
+ * thread - it rewrites only live records, so startup reads only live records and
+ * few latest stores
+ *
+ * The database is locked by the process. In the standby broker process (environment variable
+ * MMBOT_BROKER_STANDBY is set) the database is opened by activate(), after the standby process
+ * replaced the active process, which held the lock
+ */
 class OrderDataDB {
 public:
 	OrderDataDB(std::string path, unsigned int maxRows = 500);
@@ -20,14 +37,50 @@ public:
 	void store(json::Value orderId, json::Value data);
 	bool mark(json::Value orderId);
 	json::Value get(json::Value pair);
+
+	///Opens databases of the standby process, further databases are opened immediately
+	static void activate();
 protected:
+
+	struct Entry {
+		json::Value data;
+		///generation of last write
+		unsigned int gen;
+	};
+
+	using Snapshot = std::vector<std::pair<json::Value, json::Value> >;
+
+	std::string logFile, compactFile;
 	std::string frontFile, backFile;
+	std::string path;
 	std::string lock_path;
 	unsigned int curRows = 0;
 	unsigned int maxRows = 0;
-	std::unordered_map<json::Value, json::Value> curMap;
-	unsigned int load(const std::string &file);
-	int lockfile;
+	unsigned int curGen = 0;
+	std::unordered_map<json::Value, Entry> index;
+	int lockfile = -1;
+	int logfd = -1;
+	bool opened = false;
+
+	std::thread compactThr;
+	std::atomic<bool> compactDone{false};
+	bool compacting = false;
+	bool compactFailed = false;
+	///records written during compaction - they are appended to compacted log
+	std::string pending;
+
+	void append(const json::Value &orderId, const json::Value &data);
+	void rotate();
+	void finishCompaction(bool wait);
+	void loadLog();
+	void importLegacy(const std::string &file);
+	void openLog();
+	void open();
+	void checkOpened() const;
+
+	static void encode(std::string &out, const json::Value &orderId, const json::Value &data);
+	static bool writeSnapshot(const std::string &file, const Snapshot &snapshot);
+	static void writeAll(int fd, const std::string &data);
 
 };
 
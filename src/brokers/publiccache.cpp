@@ -0,0 +1,154 @@
+/*
+ * publiccache.cpp
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#include "publiccache.h"
+
+#include <unistd.h>
+#include <ctime>
+#include <cstdio>
+#include <fstream>
+#include <imtjson/object.h>
+
+PublicDataCache &PublicDataCache::getInstance() {
+	static PublicDataCache cache;
+	return cache;
+}
+
+json::Value PublicDataCache::get(const std::string_view &key, unsigned int ttl, const FetchFn &fetch) {
+	return get(key, std::chrono::milliseconds(ttl), fetch);
+}
+
+json::Value PublicDataCache::get(const std::string_view &key, std::chrono::milliseconds ttl, const FetchFn &fetch) {
+	std::unique_lock _(lock);
+	auto iter = entries.find(key);
+	if (iter == entries.end()) iter = entries.emplace(std::string(key), std::make_shared<Entry>()).first;
+	auto entry = iter->second;
+	Entry &e = *entry;
+	e.ttl = ttl;
+	if (e.fetching) {
+		//somebody else downloads the data, wait for the result
+		waits++;
+		unsigned int ver = e.version;
+		cond.wait(_, [&]{return e.version != ver;});
+		if (e.error) std::rethrow_exception(e.error);
+		return e.data;
+	}
+	auto now = Clock::now();
+	//data downloaded before the current reset round are valid only when they are not dropped by reset
+	if (e.valid && now - e.updated < ttl && (ttl >= std::chrono::milliseconds(keepTTL) || e.round == round)) {
+		hits++;
+		return e.data;
+	}
+	misses++;
+	e.fetching = true;
+	std::uint64_t fetchRound = round;
+	_.unlock();
+	json::Value data;
+	std::exception_ptr error;
+	try {
+		data = fetch();
+	} catch (...) {
+		error = std::current_exception();
+	}
+	_.lock();
+	e.fetching = false;
+	e.version++;
+	e.error = error;
+	if (!error) {
+		e.data = data;
+		e.updated = Clock::now();
+		e.round = fetchRound;
+		e.valid = true;
+	}
+	cond.notify_all();
+	if (error) std::rethrow_exception(error);
+	return data;
+}
+
+json::Value PublicDataCache::getPersistent(const std::string_view &key, unsigned int validity, const FetchFn &fetch) {
+	return get(key, std::chrono::seconds(validity), [&]{
+		std::int64_t now = std::time(nullptr);
+		json::Value rec = loadStored(key);
+		if (rec.defined() && now - rec["time"].getIntLong() < static_cast<std::int64_t>(validity)) {
+			return rec["data"];
+		}
+		json::Value data = fetch();
+		saveStored(key, data, now);
+		return data;
+	});
+}
+
+void PublicDataCache::setStorageFile(const std::string &path) {
+	std::unique_lock _(fileLock);
+	if (storageFile != path) {
+		storageFile = path;
+		storedLoaded = false;
+		stored = json::Value();
+	}
+}
+
+json::Value PublicDataCache::loadStored(const std::string_view &key) {
+	std::unique_lock _(fileLock);
+	if (!storedLoaded && !storageFile.empty()) {
+		storedLoaded = true;
+		std::ifstream f(storageFile);
+		if (!!f) try {
+			stored = json::Value::fromStream(f);
+		} catch (...) {
+			//damaged cache is ignored, it is rewritten on the next download
+			stored = json::Value();
+		}
+	}
+	return stored[json::StrViewA(key.data(), key.length())];
+}
+
+void PublicDataCache::saveStored(const std::string_view &key, const json::Value &data, std::int64_t time) {
+	std::unique_lock _(fileLock);
+	stored = stored.replace(json::StrViewA(key.data(), key.length()), json::Object("time", time)("data", data));
+	if (storageFile.empty()) return;
+	//temporary file is private to the process, the active and the standby process can save at the same time
+	std::string tmp = storageFile + "." + std::to_string(getpid()) + ".tmp";
+	{
+		std::ofstream f(tmp, std::ios::out|std::ios::trunc);
+		if (!f) return;
+		stored.toStream(f);
+		if (!f) return;
+	}
+	std::rename(tmp.c_str(), storageFile.c_str());
+}
+
+void PublicDataCache::invalidate(const std::string_view &key) {
+	std::unique_lock _(lock);
+	auto iter = entries.find(key);
+	if (iter != entries.end()) iter->second->valid = false;
+}
+
+void PublicDataCache::reset(std::uint64_t round) {
+	std::unique_lock _(lock);
+	if (round && round == roundId) return;
+	roundId = round;
+	//entries being downloaded stay, their data are not used in the new round
+	this->round++;
+	for (auto iter = entries.begin(); iter != entries.end();) {
+		const Entry &e = *iter->second;
+		if (!e.fetching && e.ttl < std::chrono::milliseconds(keepTTL)) iter = entries.erase(iter);
+		else ++iter;
+	}
+}
+
+void PublicDataCache::clear() {
+	std::unique_lock _(lock);
+	entries.clear();
+}
+
+json::Value PublicDataCache::getMetrics() const {
+	std::unique_lock _(lock);
+	return json::Object
+			("entries", entries.size())
+			("hits", hits)
+			("misses", misses)
+			("waits", waits);
+}
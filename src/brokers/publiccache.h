@@ -0,0 +1,126 @@
+/*
+ * publiccache.h
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#ifndef SRC_BROKERS_PUBLICCACHE_H_
+#define SRC_BROKERS_PUBLICCACHE_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <imtjson/value.h>
+
+///Cache of public data (tickers, market info, list of pairs) shared by all accounts in the broker process
+/**
+ * Subaccounts of the broker see the same public data, so it is downloaded
+ * once and served to all of them. Every entry has own time to live. When more
+ * threads request the same missing entry, only one of them downloads it
+ * and others wait for its result (single flight).
+ *
+ * The command "reset" carries identifier of the reset round. The robot starts new round
+ * once per cycle and resets all accounts of the broker with the same identifier. The first
+ * reset of the round drops the entries, the subaccounts reset later in the same round
+ * share the data downloaded for the first of them. Entries requested with ttl of keepTTL or
+ * longer (market info, symbols) are not dropped by the reset, they expire by the ttl.
+ */
+class PublicDataCache {
+public:
+
+	using FetchFn = std::function<json::Value()>;
+
+	///Retrieves cache shared in the process
+	static PublicDataCache &getInstance();
+
+	///Retrieves data from the cache or downloads them
+	/**
+	 * @param key key of the data (for example "ticker:BTCUSDT")
+	 * @param ttl max age of the data in milliseconds
+	 * @param fetch function which downloads the data. Exception is carried to all waiting callers
+	 * @return data
+	 */
+	json::Value get(const std::string_view &key, unsigned int ttl, const FetchFn &fetch);
+
+	///Retrieves data, which survive restart of the broker
+	/**
+	 * Data are looked up in the memory and then in the file. When they are not found or
+	 * they are older than validity, they are downloaded and stored to the file. Use it
+	 * for slowly changing data, such as symbol tables and market info.
+	 *
+	 * @param key key of the data
+	 * @param validity max age of the data in seconds
+	 * @param fetch function which downloads the data
+	 * @return data
+	 */
+	json::Value getPersistent(const std::string_view &key, unsigned int validity, const FetchFn &fetch);
+	///Sets file, where the persistent data are stored. Without the file, data are kept in memory only
+	void setStorageFile(const std::string &path);
+
+	///Drops the entry
+	void invalidate(const std::string_view &key);
+	///Starts new reset round, unless the round is already running
+	/**
+	 * @param round identifier of the round. Value 0 means unknown round, new round is always started
+	 */
+	void reset(std::uint64_t round);
+	///Drops all entries
+	void clear();
+
+	///Retrieves counters of hits, misses and waits for concurrent download
+	json::Value getMetrics() const;
+
+	///Entries with this or longer ttl are not dropped by reset() (in milliseconds)
+	static constexpr unsigned int keepTTL = 60000;
+
+protected:
+	using Clock = std::chrono::steady_clock;
+
+	struct Entry {
+		json::Value data;
+		Clock::time_point updated;
+		///ttl of the last request
+		std::chrono::milliseconds ttl{0};
+		bool valid = false;
+		bool fetching = false;
+		///error of the last download, delivered to the waiting callers
+		std::exception_ptr error;
+		///increased after every download
+		unsigned int version = 0;
+		///reset round in which the download started
+		std::uint64_t round = 0;
+	};
+
+	mutable std::mutex lock;
+	std::condition_variable cond;
+	///entries are shared with the waiting callers, so they can be dropped anytime
+	std::map<std::string, std::shared_ptr<Entry>, std::less<> > entries;
+	///counter of reset rounds
+	std::uint64_t round = 0;
+	///identifier of the current reset round received by reset()
+	std::uint64_t roundId = 0;
+	std::uint64_t hits = 0;
+	std::uint64_t misses = 0;
+	std::uint64_t waits = 0;
+
+	std::mutex fileLock;
+	std::string storageFile;
+	///content of the storage file - key: {"time":..., "data":...}
+	json::Value stored;
+	bool storedLoaded = false;
+
+	json::Value get(const std::string_view &key, std::chrono::milliseconds ttl, const FetchFn &fetch);
+	json::Value loadStored(const std::string_view &key);
+	void saveStored(const std::string_view &key, const json::Value &data, std::int64_t time);
+};
+
+
+
+#endif /* SRC_BROKERS_PUBLICCACHE_H_ */
@@ -0,0 +1,37 @@
+/*
+ * tradesync.cpp
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#include "tradesync.h"
+
+#include <algorithm>
+#include "../shared/logOutput.h"
+
+using ondra_shared::logDebug;
+
+IncrementalTradeSync::IncrementalTradeSync(unsigned int pageSize, unsigned int maxPages)
+	:pageSize(pageSize),maxPages(maxPages)
+{
+}
+
+IncrementalTradeSync::TradesSync IncrementalTradeSync::sync(const json::Value &cursor, const FetchPage &fetch) {
+	TradesSync res{{}, cursor};
+	more = false;
+	for (unsigned int i = 0; i < maxPages; i++) {
+		Page p = fetch(res.lastId, pageSize);
+		//keep order of the exchange for trades with the same time
+		std::stable_sort(p.trades.begin(), p.trades.end(), [](const Trade &a, const Trade &b) {
+			return a.time < b.time;
+		});
+		res.trades.insert(res.trades.end(), p.trades.begin(), p.trades.end());
+		json::Value prev = res.lastId;
+		if (p.cursor.defined()) res.lastId = p.cursor;
+		//full page without progress would loop forever
+		more = p.more && res.lastId != prev;
+		if (!more) break;
+	}
+	if (more) logDebug("Trade sync: $1 trades downloaded, continue in next cycle", res.trades.size());
+	return res;
+}
@@ -0,0 +1,65 @@
+/*
+ * tradesync.h
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#ifndef SRC_BROKERS_TRADESYNC_H_
+#define SRC_BROKERS_TRADESYNC_H_
+
+#include <functional>
+#include "../main/istockapi.h"
+
+///Incremental synchronization of trades through paged REST requests
+/**
+ * Each call of sync() downloads at most maxPages pages of pageSize trades,
+ * starting at the cursor. Trades are returned ordered and the cursor is moved
+ * after the last downloaded trade. The cursor is returned as lastId, so
+ * it is persisted along with the state of the trader. When there is more trades
+ * than can be downloaded in the single call, the rest is downloaded in next cycles
+ */
+class IncrementalTradeSync {
+public:
+
+	using Trade = IStockApi::Trade;
+	using TradeHistory = IStockApi::TradeHistory;
+	using TradesSync = IStockApi::TradesSync;
+
+	struct Page {
+		///trades of the page (excluding the trade at the cursor)
+		TradeHistory trades;
+		///cursor after the page - undefined if not changed
+		json::Value cursor;
+		///page is full - there can be more trades
+		bool more;
+	};
+
+	///Downloads single page
+	/**
+	 * @param cursor current cursor
+	 * @param limit maximum trades in the page
+	 */
+	using FetchPage = std::function<Page(const json::Value &cursor, unsigned int limit)>;
+
+	IncrementalTradeSync(unsigned int pageSize = 100, unsigned int maxPages = 5);
+
+	///Downloads trades from the cursor
+	/**
+	 * @param cursor cursor (lastId)
+	 * @param fetch function which downloads a page
+	 * @return trades and new cursor
+	 */
+	TradesSync sync(const json::Value &cursor, const FetchPage &fetch);
+
+	///Last sync stopped on limit of pages, there are more trades to download
+	bool hasMore() const {return more;}
+
+	unsigned int getPageSize() const {return pageSize;}
+
+protected:
+	unsigned int pageSize;
+	unsigned int maxPages;
+	bool more = false;
+};
+
+#endif /* SRC_BROKERS_TRADESYNC_H_ */
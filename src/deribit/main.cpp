@@ -17,6 +17,7 @@
 #include <ctime>
 
 #include "../brokers/api.h"
+#include "../brokers/publiccache.h"
 #include <imtjson/stringValue.h>
 #include "../shared/linear_map.h"
 #include "../shared/iterator_stream.h"
@@ -79,7 +80,8 @@ public:
 	}
 
 
-	ondra_shared::linear_map<std::string, double, std::less<std::string_view> > tick_cache;
+	///Retrieves the instrument, it is shared by all subaccounts through PublicDataCache
+	json::Value getInstrument(const std::string_view &pair);
 
 	ondra_shared::linear_map<std::string, json::Value, std::less<std::string_view> > openOrdersCache;
 
@@ -217,15 +219,7 @@ inline json::Value Interface::placeOrder(const std::string_view &pair,
 		double size, double price, json::Value clientId, json::Value replaceId,
 		double replaceSize) {
 
-	double tick_size;
-	{
-		auto tick_iter = tick_cache.find(pair);
-		if (tick_iter == tick_cache.end()) {
-			getMarketInfo(pair);
-			tick_iter = tick_cache.find(pair);
-		}
-		tick_size = tick_iter->second;
-	}
+	double tick_size = getInstrument(pair)["tick_size"].getNumber();
 
 	double adj_price = 1.0/price;
 	adj_price = std::round(adj_price / tick_size) * tick_size;
@@ -265,28 +259,31 @@ inline bool Interface::reset() {
 	return true;
 }
 
-inline Interface::MarketInfo Interface::getMarketInfo(const std::string_view &pair) {
-	auto csize = px.request("public/get_contract_size", Object
-			("instrument_name", pair),false);
-	auto currencies = px.request("public/get_currencies", Object(),false);
-	Value instrument;
-	for (Value c: currencies) {
-		Value sign = c["currency"];
-		auto instrs = px.request("public/get_instruments", Object
-				("currency",sign)
-				("kind","future")
-				("expired",false),false);
-		for (Value i: instrs) {
-			if (i["instrument_name"].getString() == pair) {
-				instrument = i;
-				break;
+inline json::Value Interface::getInstrument(const std::string_view &pair) {
+	std::string key = px.apiUrl;
+	key.append("/instrument/").append(pair);
+	return PublicDataCache::getInstance().get(key, 3600000, [&]{
+		auto currencies = px.request("public/get_currencies", Object(),false);
+		for (Value c: currencies) {
+			Value sign = c["currency"];
+			auto instrs = px.request("public/get_instruments", Object
+					("currency",sign)
+					("kind","future")
+					("expired",false),false);
+			for (Value i: instrs) {
+				if (i["instrument_name"].getString() == pair) {
+					return i;
+				}
 			}
 		}
-		if (instrument.defined())
-			break;
-	}
-	if (!instrument.defined())
 		throw std::runtime_error("No such symbol");
+	});
+}
+
+inline Interface::MarketInfo Interface::getMarketInfo(const std::string_view &pair) {
+	auto csize = px.request("public/get_contract_size", Object
+			("instrument_name", pair),false);
+	Value instrument = getInstrument(pair);
 
 	auto bcur = instrument["base_currency"].getString();
 	double leverage;
@@ -294,7 +291,6 @@ inline Interface::MarketInfo Interface::getMarketInfo(const std::string_view &pa
 	else if (bcur == "ETH") leverage=50.0;
 	else leverage = 0;
 
-	tick_cache[pair] = instrument["tick_size"].getNumber();
 	return {
 		std::string("$").append(pair),
 		bcur,
@@ -20,6 +20,8 @@
 #include <sys/wait.h>
 #include <experimental/filesystem>
 
+#include <algorithm>
+#include <cctype>
 #include <cstring>
 #include <sstream>
 #include <thread>
@@ -27,6 +29,7 @@
 #include <imtjson/binjson.tcc>
 
 #include "../shared/linux_waitpid.h"
+#include "binframe.h"
 #include "istockapi.h"
 
 const int AbstractExtern::invval = -1;
@@ -91,10 +94,15 @@ void report_error(const char *desc) {
 	throw std::runtime_error(buff.str());
 }
 
+class BrokerTimeout: public std::runtime_error {
+public:
+	using std::runtime_error::runtime_error;
+};
+
 void report_timeout(const char *desc) {
 	std::ostringstream buff;
 	buff << "TIMEOUT while '" << desc << '"';
-	throw std::runtime_error(buff.str());
+	throw BrokerTimeout(buff.str());
 
 }
 
@@ -110,166 +118,325 @@ AbstractExtern::Pipe AbstractExtern::makePipe() {
 
 
 
-void AbstractExtern::spawn() {
-	Sync _(lock);
+void AbstractExtern::forkProcess(Process &p, bool standby) {
 	using ondra_shared::Handle;
 
 	int status;
 	//collect any zombie
 	waitpid(-1,&status,WNOHANG);
 
-	{
+	Pipe proc_input (makePipe());
+	Pipe proc_output (makePipe());
+	Pipe proc_error (makePipe());
+	Pipe proc_control (makePipe());
 
-		log.progress("Connecting to broker: cmdline='$1', workdir='$2'", cmdline, workingDir);
+	parseArgumentList(cmdline, [&](char * const arglist[]) {
 
-		Pipe proc_input (makePipe());
-		Pipe proc_output (makePipe());
-		Pipe proc_error (makePipe());
-		Pipe proc_control (makePipe());
+		pid_t frk = fork();
+		if (frk == -1) {
+			int err = errno;
+			throw std::runtime_error(strerror(err));
+		}
+		if (frk == 0) {
+			//ignore signal SIGINT - we don't need it, but gdb send SIGINT on interrupt
+			signal(SIGINT, SIG_IGN);
+
+			try {
+				std::experimental::filesystem::current_path(workingDir);
+				if (dup2(proc_input.read, 0)<0) report_error("dup->stdin");
+				if (dup2(proc_output.write, 1)<0) report_error("dup->stdout");
+				if (dup2(proc_error.write, 2)<0) report_error("dup->stderr");
+				if (standby) setenv("MMBOT_BROKER_STANDBY", "1", 1);
+				execvp(arglist[0], arglist);
+				report_error("execlp");
+
+			} catch (std::exception &e) {
+
+				const char *w = e.what();
+				if (write(proc_control.write, w, strlen(w))<0) exit(0);
+			}
+			exit(0);
 
-		parseArgumentList(cmdline, [&](char * const arglist[]) {
+		} else {
 
-			pid_t frk = fork();
-			if (frk == -1) {
-				int err = errno;
-				throw std::runtime_error(strerror(err));
-			}
-			if (frk == 0) {
-				//ignore signal SIGINT - we don't need it, but gdb send SIGINT on interrupt
-				signal(SIGINT, SIG_IGN);
-
-				try {
-					std::experimental::filesystem::current_path(workingDir);
-					if (dup2(proc_input.read, 0)<0) report_error("dup->stdin");
-					if (dup2(proc_output.write, 1)<0) report_error("dup->stdout");
-					if (dup2(proc_error.write, 2)<0) report_error("dup->stderr");
-					execvp(arglist[0], arglist);
-					report_error("execlp");
-
-				} catch (std::exception &e) {
-
-					const char *w = e.what();
-					if (write(proc_control.write, w, strlen(w))<0) exit(0);
+			proc_control.write.close();
+			std::string errmsg;
+			{
+				char buff[256];
+				auto r = read(proc_control.read, buff, sizeof(buff));
+				while (r > 0) {
+					errmsg.append(buff,r);
+					r = read(proc_control.read, buff, sizeof(buff));
 				}
-				exit(0);
+			}
+			if (!errmsg.empty()) throw std::runtime_error(errmsg);
+			p.out = std::move(proc_output.read);
+			p.err = std::move(proc_error.read);
+			p.in = std::move(proc_input.write);
+			p.pid = frk;
+		}
+	});
+}
 
-			} else {
+void AbstractExtern::spawn() {
+	Sync _(lock);
 
-				proc_control.write.close();
-				std::string errmsg;
-				{
-					char buff[256];
-					auto r = read(proc_control.read, buff, sizeof(buff));
-					while (r > 0) {
-						errmsg.append(buff,r);
-						r = read(proc_control.read, buff, sizeof(buff));
-					}
-				}
-				if (!errmsg.empty()) throw std::runtime_error(errmsg);
-				extout = std::move(proc_output.read);
-				exterr = std::move(proc_error.read);
-				extin = std::move(proc_input.write);
-				chldid = frk;
-				houseKeepingCounter = 0;
+	if (takeSpare()) {
+		try {
+			//previous process is gone, the spare can open state of the account
+			json::Value r = jsonExchange({"activate", true}, true);
+			if (!r[0].getBool()) throw std::runtime_error(r[1].toString().str());
+			log.progress("Switched to the standby broker");
+			onConnect();
+			startSpare();
+			return;
+		} catch (std::exception &e) {
+			log.warning("Failed to activate the standby broker: $1", e.what());
+			kill();
+		}
+	}
+
+	log.progress("Connecting to broker: cmdline='$1', workdir='$2'", cmdline, workingDir);
+
+	{
+		Process p;
+		forkProcess(p, false);
+		extout = std::move(p.out);
+		exterr = std::move(p.err);
+		extin = std::move(p.in);
+		chldid = p.pid;
+		houseKeepingCounter = 0;
+	}
+
+	binaryMode = false;
+	eventsEnabled = false;
+	connectChannel();
+	if (binaryFraming) {
+		try {
+			json::Value r = jsonExchange({"binaryFraming", true}, true);
+			binaryMode = r[0].getBool() && r[1].getBool();
+		} catch (std::exception &e) {
+			log.debug("Binary framing negotiation failed: $1", e.what());
+		}
+		if (!binaryMode) {
+			//don't try again, the broker doesn't support it
+			binaryFraming = false;
+			//broker didn't survive the unknown command
+			if (chldid == -1) {
+				spawn();
+				return;
 			}
-		});
+		}
+	}
+	//only brokers which know binary framing can know events
+	if (binaryMode) {
+		try {
+			json::Value r = jsonExchange({"enableEvents", true}, true);
+			eventsEnabled = r[0].getBool() && r[1].getBool();
+		} catch (std::exception &e) {
+			log.debug("Events are not supported: $1", e.what());
+		}
 	}
 
 	onConnect();
+	startSpare();
 
 
 }
 
-void AbstractExtern::handleClose(int fd) {
-	::close(fd);
+bool AbstractExtern::takeSpare() {
+	std::unique_lock _(spareLock);
+	if (!spare.has_value()) return false;
+	Process &p = *spare;
+	//the spare could die while it was waiting
+	if (p.channel->isClosed()) {
+		closeProcess(p);
+		spare.reset();
+		return false;
+	}
+	extout = std::move(p.out);
+	exterr = std::move(p.err);
+	extin = std::move(p.in);
+	chldid = p.pid;
+	binaryMode = p.binaryMode;
+	eventsEnabled = p.eventsEnabled;
+	houseKeepingCounter = 0;
+	//the spare is already registered to the reactor
+	channel = std::move(p.channel);
+	reactorId = p.reactorId;
+	spare.reset();
+	return true;
 }
 
+void AbstractExtern::connectChannel() {
+	channel = std::make_shared<ExternChannel>(name, &counters.bytesIn);
+	reactorId = ExternReactor::getInstance().add(extout, exterr, channel);
+}
 
-void AbstractExtern::kill() {
-	Sync _(lock);
-	if (chldid != -1) {
+void AbstractExtern::disconnectChannel() {
+	if (reactorId) {
+		ExternReactor::getInstance().remove(reactorId);
+		reactorId = 0;
+	}
+	if (channel) {
+		channel->onClose();
+		auto ev = channel->takeEvents();
+		events.insert(events.end(), ev.begin(), ev.end());
+		channel.reset();
+	}
+}
 
-		ondra_shared::WaitPid wpid(chldid);
-		extin.close();
-		if (!wpid.wait_for(std::chrono::seconds(3))) {
-			::kill(chldid, SIGTERM);
-			if (!wpid.wait_for(std::chrono::seconds(10))) {
-				::kill(chldid, SIGKILL);
-				if (!wpid.wait_for(std::chrono::seconds(10))) {
-					log.error("Unable to terminate broker! (TIMEOUT waiting on SIGKILL)");
-				}
-			}
-		}
-		int status = wpid.getExitCode();
-		if (WIFSIGNALED(status)) {
-			log.note("Broker process disconnected because signal: $1", WTERMSIG(status));
+void AbstractExtern::startSpare() {
+	if (!standby || spareBusy) return;
+	unsigned int generation;
+	{
+		std::unique_lock _(spareLock);
+		if (spare.has_value()) return;
+		generation = spareGeneration;
+	}
+	//thread has finished already (spareBusy is false)
+	if (spareThread.joinable()) spareThread.join();
+	spareBusy = true;
+	spareThread = std::thread([this, binary = binaryMode, generation]{
+		prepareSpare(binary, generation);
+		spareBusy = false;
+	});
+}
+
+void AbstractExtern::prepareSpare(bool binary, unsigned int generation) {
+	Process p;
+	try {
+		forkProcess(p, true);
+		//output of the idle spare is drained by the reactor, so the spare can't block on a full pipe
+		p.channel = std::make_shared<ExternChannel>(name, &counters.bytesIn);
+		p.reactorId = ExternReactor::getInstance().add(p.out, p.err, p.channel);
+		//the first command initializes the broker
+		if (binary) {
+			json::Value r = processExchange(p, {"binaryFraming", true}, false);
+			p.binaryMode = r[0].getBool() && r[1].getBool();
+			if (!p.binaryMode) throw std::runtime_error("Binary framing negotiation failed");
+			r = processExchange(p, {"enableEvents", true}, true);
+			p.eventsEnabled = r[0].getBool() && r[1].getBool();
 		} else {
-			log.note("Broker process disconnected. Exit code : $1", WEXITSTATUS(status));
+			processExchange(p, {"getBrokerInfo", json::Value()}, false);
 		}
-		chldid = -1;
+	} catch (std::exception &e) {
+		log.warning("Failed to start standby broker: $1", e.what());
+		closeProcess(p);
+		return;
 	}
+	{
+		std::unique_lock _(spareLock);
+		if (generation == spareGeneration) {
+			spare.emplace(std::move(p));
+			return;
+		}
+	}
+	//the spare was dropped while it was starting
+	closeProcess(p);
 }
 
-AbstractExtern::~AbstractExtern() {
-	kill();
+json::Value AbstractExtern::processExchange(Process &p, json::Value request, bool binary) {
+	auto reply = p.channel->expectReply();
+	if (!writeJSON(request, p.in, timeout, binary))
+		throw std::runtime_error("Broker closed connection");
+	if (timeout >= 0 && reply.wait_for(std::chrono::milliseconds(timeout)) != std::future_status::ready) {
+		report_timeout("standby broker");
+	}
+	return reply.get().msg;
 }
 
-static void waitForRead(int fd, int timeout) {
-	struct pollfd fds = {fd, POLLIN|POLLHUP,0};
-	int r = poll(&fds, 1, timeout);
-	if (r != 1) throw std::runtime_error("Broker read timeout");
+void AbstractExtern::closeProcess(Process &p) {
+	if (p.reactorId) {
+		ExternReactor::getInstance().remove(p.reactorId);
+		p.reactorId = 0;
+	}
+	if (p.channel) {
+		p.channel->onClose();
+		p.channel.reset();
+	}
+	if (p.pid != -1) {
+		terminate(p.pid, p.in);
+		p.pid = -1;
+	}
 }
-static void waitForWrite(int fd, int timeout) {
-	struct pollfd fds = {fd, POLLOUT,0};
-	int r = poll(&fds, 1, timeout);
-	if (r != 1) throw std::runtime_error("Broker write timeout");
+
+void AbstractExtern::dropSpare() {
+	std::unique_lock _(spareLock);
+	spareGeneration++;
+	if (spare.has_value()) {
+		closeProcess(*spare);
+		spare.reset();
+	}
 }
 
+void AbstractExtern::setStandby(bool enable) {
+	Sync _(lock);
+	standby = enable;
+	if (!enable) dropSpare();
+	else if (chldid != -1) startSpare();
+}
 
-class AbstractExtern::Reader {
-public:
-	Reader (FD &fd, int timeout):fd(fd),timeout(timeout) {}
-	std::string_view read() {
-		if (buff.empty()) {
-			return readBuff();
-		}
-		else {
-			auto x = buff;
-			buff = std::string_view();
-			return x;
+void AbstractExtern::handleClose(int fd) {
+	::close(fd);
+}
+
+
+void AbstractExtern::terminate(pid_t pid, FD &in) {
+	ondra_shared::WaitPid wpid(pid);
+	in.close();
+	if (!wpid.wait_for(std::chrono::seconds(3))) {
+		::kill(pid, SIGTERM);
+		if (!wpid.wait_for(std::chrono::seconds(10))) {
+			::kill(pid, SIGKILL);
+			if (!wpid.wait_for(std::chrono::seconds(10))) {
+				log.error("Unable to terminate broker! (TIMEOUT waiting on SIGKILL)");
+			}
 		}
 	}
-	void putback(std::string_view data) {
-		buff = data;
+	int status = wpid.getExitCode();
+	if (WIFSIGNALED(status)) {
+		log.note("Broker process disconnected because signal: $1", WTERMSIG(status));
+	} else {
+		log.note("Broker process disconnected. Exit code : $1", WEXITSTATUS(status));
 	}
+}
 
-	int operator()() {
-		auto d = read();
-		if (d.empty()) return -1;
-		char z = d[0];
-		putback(d.substr(1));
-		return z;
+void AbstractExtern::kill() {
+	Sync _(lock);
+	if (chldid != -1) {
+		disconnectChannel();
+		terminate(chldid, extin);
+		chldid = -1;
 	}
+}
 
-protected:
-	std::string_view buff;
-	char data[1000];
-	FD &fd;
-	int timeout;
-
-	std::string_view readBuff() {
-		waitForRead(fd,timeout);
-		int i = ::read(fd, data, sizeof(data));
-		if (i < 1) return std::string_view();
-		else return std::string_view(data, i);
-	}
-};
+AbstractExtern::~AbstractExtern() {
+	kill();
+	dropSpare();
+	if (spareThread.joinable()) spareThread.join();
+}
+
+static void waitForWrite(int fd, int timeout) {
+	struct pollfd fds = {fd, POLLOUT,0};
+	int r = poll(&fds, 1, timeout);
+	if (r != 1) throw BrokerTimeout("Broker write timeout");
+}
 
 
-bool AbstractExtern::writeJSON(json::Value v, FD& fd, int timeout) {
-	auto s = v.stringify();
-	s = s + "\n";
-	std::string_view ss(s.c_str(),s.length());
+bool AbstractExtern::writeJSON(json::Value v, FD& fd, int timeout, bool binary) {
+	std::string s;
+	if (binary) {
+		s = BinaryFrame::encode(v);
+	} else {
+		auto t = v.stringify();
+		s.reserve(t.length()+1);
+		s.append(t.c_str(), t.length());
+		s.push_back('\n');
+	}
+	std::string_view ss(s);
+	counters.bytesOut.fetch_add(s.size(), std::memory_order_relaxed);
+	threadCallStats().bytesOut += s.size();
 	while (!ss.empty()) {
 		waitForWrite(fd, timeout);
 		int i = write(fd, ss.data(), ss.length());
@@ -283,7 +450,7 @@ bool AbstractExtern::writeJSON(json::Value v, FD& fd, int timeout) {
 
 void AbstractExtern::housekeeping(int counter) {
 	Sync _(lock);
-	if (chldid != -1) {
+	if (chldid != -1 && pendingReplies == 0) {
 		houseKeepingCounter++;
 		if (houseKeepingCounter >= counter) {
 			log.progress("Stopping the idle broker");
@@ -294,12 +461,6 @@ void AbstractExtern::housekeeping(int counter) {
 	}
 }
 
-json::Value AbstractExtern::readJSON(FD& fd, int timeout) {
-	return json::Value::parse(Reader(fd, timeout));
-
-}
-
-
 bool AbstractExtern::preload() {
 	try {
 		Sync _(lock);
@@ -316,6 +477,19 @@ bool AbstractExtern::preload() {
 
 void AbstractExtern::stop() {
 	kill();
+	dropSpare();
+}
+
+std::vector<json::Value> AbstractExtern::collectEvents() {
+	Sync _(lock, std::try_to_lock);
+	if (!_.owns_lock()) return {};
+	std::vector<json::Value> res;
+	res.swap(events);
+	if (channel) {
+		auto ev = channel->takeEvents();
+		res.insert(res.end(), ev.begin(), ev.end());
+	}
+	return res;
 }
 
 json::Value AbstractExtern::jsonExchange(json::Value request, bool idle) {
@@ -323,70 +497,60 @@ json::Value AbstractExtern::jsonExchange(json::Value request, bool idle) {
 
 	if (!idle) houseKeepingCounter=0;
 
-	std::string z;
-	std::string lastStdErr;
-
+	//process died while it was idle
+	if (chldid != -1 && channel->isClosed()) {
+		kill();
+	}
 	if (chldid == -1) {
 		spawn();
 	}
 	bool verbose = log.isLogLevelEnabled(ondra_shared::LogLevel::debug);
 	if (verbose) log.debug("SEND: $1", request.toString().substr(0,512));
-	if (writeJSON(request, extin, timeout) == false) {
+	PExternChannel ch = channel;
+	auto reply = ch->expectReply();
+	try {
+		if (writeJSON(request, extin, timeout, binaryMode) == false) {
+			throw std::runtime_error("Connection to API lost - unable to send the request");
+		}
+	} catch (...) {
 		kill();
+		throw;
 	}
-	do {
-		try {
-			struct pollfd fds[2];
-			fds[0].fd = extout;
-			fds[0].events = POLLIN;
-			fds[0].revents = 0;
-			fds[1].fd = exterr;
-			fds[1].events = POLLIN;
-			fds[1].revents = 0;
-			int r = poll(fds,2,timeout);
-			if (r == 0) report_timeout("poll");
-			if (r < 0) report_error("poll");
-			if (fds[1].revents) {
-				Reader errrd(exterr, timeout);
-				bool rep;
-				do {
-					lastStdErr = std::move(z);
-					do {
-						auto buff = errrd.read();
-						if (buff.empty()) {
-							throw std::runtime_error(json::String({
-								"Connection to API lost: ",
-								request.toString()," - err: ",
-									lastStdErr.empty()?"N/A": lastStdErr.c_str()}).c_str());
-						}
-						auto pos = buff.find('\n');
-						if (pos == buff.npos) z.append(buff);
-						else {
-							z.append(buff.substr(0,pos));
-							errrd.putback(buff.substr(pos+1));
-							rep = pos+1 < buff.length();
-							log.note("stderr: $1",  z);
-							break;
-						}
-					} while (true);
-				}while (rep);
-			}
-			if (fds[0].revents) {
-					auto ret = readJSON(extout, timeout);
-					if (verbose) log.debug("RECV: $1", ret.toString().substr(0,512));
-					return ret;
-
-			}
-		} catch (...) {
-			kill();
-			throw;
+	//other threads can send requests while the reply is pending
+	pendingReplies++;
+	_.unlock();
+	try {
+		if (timeout >= 0 && reply.wait_for(std::chrono::milliseconds(timeout)) != std::future_status::ready) {
+			report_timeout("reply");
 		}
+		ExternChannel::Reply ret = reply.get();
+		threadCallStats().bytesIn += ret.bytes;
+		if (verbose) log.debug("RECV: $1", ret.msg.toString().substr(0,512));
+		_.lock();
+		pendingReplies--;
+		return ret.msg;
+	} catch (const BrokerTimeout &) {
+		counters.timeouts.fetch_add(1, std::memory_order_relaxed);
+		threadCallStats().timeout = true;
+		_.lock();
+		pendingReplies--;
+		//process could be already replaced by other thread
+		if (channel == ch) kill();
+		throw;
+	} catch (...) {
+		_.lock();
+		pendingReplies--;
+		if (channel == ch) kill();
+		throw;
 	}
-	while (true);
+}
+
+AbstractExtern::CallStats &AbstractExtern::threadCallStats() {
+	static thread_local CallStats stats;
+	return stats;
 }
 
 json::Value AbstractExtern::jsonRequestExchange(json::String name, json::Value args, bool idle) {
-	Sync _(lock);
 	try {
 		auto resp = jsonExchange({name, args}, idle);
 		if (resp[0].getBool() == true) {
@@ -7,7 +7,11 @@
 
 #ifndef SRC_MAIN_ABSTRACTEXTERN_H_
 #define SRC_MAIN_ABSTRACTEXTERN_H_
+#include <atomic>
 #include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
 
 #include <imtjson/string.h>
 #include <imtjson/value.h>
@@ -15,6 +19,7 @@
 
 #include "../shared/handle.h"
 #include "../shared/logOutput.h"
+#include "externreactor.h"
 class AbstractExtern {
 public:
 
@@ -32,9 +37,55 @@ public:
 	 * @param args arguments
 	 * @param idle set true if the command is called during idle, so it is not tread as action
 	 * @return result value
+	 *
+	 * @note The function can be called from more threads. Requests are pipelined, the next
+	 * request is sent while the reply of the previous request is pending. The process
+	 * executes requests in order of sending
 	 */
 	json::Value jsonRequestExchange(json::String name, json::Value args, bool idle = false);
 
+	///Traffic counters (updated under the lock, readable anytime)
+	struct Counters {
+		std::atomic<std::uint64_t> bytesOut{0};
+		std::atomic<std::uint64_t> bytesIn{0};
+		std::atomic<std::uint64_t> timeouts{0};
+	};
+
+	const Counters &getCounters() const {return counters;}
+
+	///Traffic of the requests sent by the current thread
+	struct CallStats {
+		std::uint64_t bytesOut = 0;
+		std::uint64_t bytesIn = 0;
+		bool timeout = false;
+	};
+
+	///Retrieves statistics of the current thread. Caller resets them before the request
+	/** Requests of more threads can be pending on the same process, so global counters
+	 * can't be used to measure single request
+	 */
+	static CallStats &threadCallStats();
+
+	///Retrieves events sent by the broker
+	/**
+	 * Broker can send unsolicited message ["event", <event>] anytime when events are
+	 * enabled (command "enableEvents"). Events are received by the reactor and queued.
+	 * It doesn't block, if the broker is busy, it returns events queued so far
+	 */
+	std::vector<json::Value> collectEvents();
+
+	///Enables standby process
+	/**
+	 * When enabled, a spare broker process is started and initialized on the background
+	 * after the broker is connected. The spare process doesn't open state of the account
+	 * (order database, keys), which is held by the active process. When the broker crashes or
+	 * it is killed because timeout, the spare process is activated and replaces it
+	 * immediately (onConnect() is called again) and a new spare process is started. Output
+	 * of the idle spare process is read by the reactor. Stopping the idle broker also stops
+	 * the spare process
+	 */
+	void setStandby(bool enable);
+
 	class Exception: public std::exception {
 	public:
 		Exception(std::string &&msg, const std::string &name, const std::string &command);
@@ -76,19 +127,85 @@ protected:
 	mutable std::recursive_mutex lock;
 	using Sync = std::unique_lock<std::recursive_mutex>;
 
-	class Reader;
-
 	void spawn();
 	void kill();
 
 	static Pipe makePipe();
+
+	///Started broker process
+	struct Process {
+		FD in;
+		FD out;
+		FD err;
+		pid_t pid = -1;
+		bool binaryMode = false;
+		bool eventsEnabled = false;
+		///receives output of the process through the reactor
+		PExternChannel channel;
+		std::uint64_t reactorId = 0;
+	};
+
+	///Starts the process (doesn't initialize it)
+	/**
+	 * @param p receives the process
+	 * @param standby start the process as standby broker. It doesn't open state of the
+	 * account (order database, keys) until it receives the command "activate"
+	 */
+	void forkProcess(Process &p, bool standby);
+	///Sends request to the process, which is not current process (the spare process)
+	json::Value processExchange(Process &p, json::Value request, bool binary);
+	///Unregisters the process from the reactor and terminates it
+	void closeProcess(Process &p);
+	///Terminates the process
+	void terminate(pid_t pid, FD &in);
+	///Replaces current process by the spare process if it is available
+	bool takeSpare();
+	///Starts new spare process on the background
+	void startSpare();
+	///Stops the spare process
+	/** Doesn't wait for the spare thread, so it can be called under the lock. The spare
+	 * being started is closed by the spare thread once it is ready
+	 */
+	void dropSpare();
+	///Starts and initializes the spare process (called in the spare thread)
+	/**
+	 * @param binary use binary framing
+	 * @param generation value of spareGeneration when the spare was requested
+	 */
+	void prepareSpare(bool binary, unsigned int generation);
+
 	int msgCntr = 1;
 	int houseKeepingCounter = 0;
+	///count of requests waiting for the reply (process is not stopped by housekeeping)
+	unsigned int pendingReplies = 0;
+	///binary framing is allowed (cleared when broker doesn't support it)
+	bool binaryFraming = true;
+	///binary framing is active
+	bool binaryMode = false;
+	///broker sends events
+	bool eventsEnabled = false;
+	Counters counters;
+	///receives output of the process through the reactor
+	PExternChannel channel;
+	std::uint64_t reactorId = 0;
+	///events of the previous process, not collected yet
+	std::vector<json::Value> events;
+	bool standby = false;
+	///protects the spare process
+	std::mutex spareLock;
+	std::optional<Process> spare;
+	///increased by dropSpare(), the spare requested before is not used
+	unsigned int spareGeneration = 0;
+	std::thread spareThread;
+	std::atomic<bool> spareBusy{false};
 
 
 	json::Value jsonExchange(json::Value request, bool idle);
-	static bool writeJSON(json::Value v, FD &fd, int timeout);
-	static json::Value readJSON(FD &fd, int timeout);
+	bool writeJSON(json::Value v, FD &fd, int timeout, bool binary);
+	///Registers current process to the reactor
+	void connectChannel();
+	///Unregisters current process from the reactor
+	void disconnectChannel();
 
 };
 
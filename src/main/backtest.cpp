@@ -29,6 +29,8 @@ BTTrades backtest_cycle(const MTrader_Config &cfg, BTPriceSource &&priceSource,
 
 	double pl = 0;
 	double minsize = std::max(minfo.min_size, cfg.min_size);
+	FillModel fmodel(cfg.fill_model);
+	IStockApi::MarketInfo fminfo = minfo;
 	int cont = 0;
 	const std::uint64_t sliding_spread_wait = cfg.spread_calc_sma_hours *50000;
 	const std::uint64_t delayed_alert_wait = cfg.accept_loss * 3600000;
@@ -53,6 +55,7 @@ BTTrades backtest_cycle(const MTrader_Config &cfg, BTPriceSource &&priceSource,
 						|| (cfg.delayed_alerts &&  price->time - bt.price.time >delayed_alert_wait);
 				checksl = order.alert == IStrategy::Alert::forced || order.alert == IStrategy::Alert::stoploss;
 				Strategy::adjustOrder(dir, mult, allowAlert, order);
+				order.size = fmodel.fillAtPrice(order.size, price->time - bt.price.time);
 				order.size  = IStockApi::MarketInfo::adjValue(order.size,minfo.asset_step,round);
 				if (std::abs(order.size) < minsize) {
 					order.size = 0;
@@ -60,18 +63,25 @@ BTTrades backtest_cycle(const MTrader_Config &cfg, BTPriceSource &&priceSource,
 				if (cfg.max_size && std::abs(order.size) > cfg.max_size) {
 					order.size = cfg.max_size*sgn(order.size);
 				}
+				//apply fees of current fee tier (no fees without tiers)
+				double eff_size = order.size;
+				double eff_price = p;
+				fminfo.fees = fmodel.getFees(0);
+				fminfo.removeFees(eff_size, eff_price);
 				if (!minfo.leverage) {
-					double chg = order.size*p;
-					if (balance - chg < 0 || pos + order.size < 0) {
+					double chg = eff_size*eff_price;
+					if (balance - chg < 0 || pos + eff_size < 0) {
 						order.size = 0;
+						eff_size = 0;
 						chg = 0;
 					}
 					balance -= chg;
-					pos += order.size;
+					pos += eff_size;
 				} else {
-					pos += order.size;
+					pos += eff_size;
 				}
-				auto tres = s.onTrade(minfo, p, order.size, pos, balance);
+				if (order.size) fmodel.addVolume(price->time, order.size*p);
+				auto tres = s.onTrade(minfo, eff_price, eff_size, pos, balance);
 				bt.neutral_price = tres.neutralPrice;
 				bt.norm_accum += tres.normAccum;
 				bt.norm_profit += tres.normProfit;
@@ -0,0 +1,69 @@
+/*
+ * binframe.h
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#ifndef SRC_MAIN_BINFRAME_H_
+#define SRC_MAIN_BINFRAME_H_
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <imtjson/value.h>
+#include <imtjson/binjson.tcc>
+
+///Binary framing of messages between mmbot and the broker
+/**
+ * Frame: marker (0x00), length of data (32bit little endian), data (imtjson binary format)
+ *
+ * Text messages never start with the marker, so the reader can accept both formats. Binary
+ * mode is negotiated by the command "binaryFraming". Brokers, which don't know the
+ * command, stay in text mode
+ */
+class BinaryFrame {
+public:
+
+	static constexpr int marker = 0;
+	///size of length field
+	static constexpr std::size_t lengthSize = 4;
+	///maximum size of data of the frame. Larger frame means corrupted stream
+	static constexpr std::uint32_t maxLength = 64*1024*1024;
+
+	///Creates frame including the marker
+	static std::string encode(const json::Value &v) {
+		std::string out;
+		out.push_back(static_cast<char>(marker));
+		out.append(lengthSize, '\0');
+		v.serializeBinary([&](char c){out.push_back(c);});
+		std::uint32_t len = static_cast<std::uint32_t>(out.size() - lengthSize - 1);
+		for (std::size_t i = 0; i < lengthSize; i++) out[i+1] = static_cast<char>((len >> (8*i)) & 0xFF);
+		return out;
+	}
+
+	///Decodes length field (which follows the marker)
+	/** Throws exception, when the length exceeds maxLength. The stream can't be
+	 * resynchronized then, it must be closed
+	 */
+	static std::uint32_t decodeLength(const char *hdr) {
+		std::uint32_t len = 0;
+		for (std::size_t i = 0; i < lengthSize; i++)
+			len |= static_cast<std::uint32_t>(static_cast<unsigned char>(hdr[i])) << (8*i);
+		if (len > maxLength) throw std::runtime_error("Frame too large: " + std::to_string(len));
+		return len;
+	}
+
+	///Parses data of the frame
+	static json::Value decode(const std::string_view &data) {
+		std::size_t pos = 0;
+		return json::Value::parseBinary([&]{
+			if (pos >= data.size()) throw std::runtime_error("Unexpected end of frame");
+			return static_cast<int>(static_cast<unsigned char>(data[pos++]));
+		}, json::base64);
+	}
+};
+
+
+
+#endif /* SRC_MAIN_BINFRAME_H_ */
@@ -10,14 +10,16 @@
 
 #include <imtjson/string.h>
 #include <chrono>
+#include <cmath>
 
 std::string_view EmulatorAPI::prefix = "$emulator_";
 
 #include "../shared/logOutput.h"
-EmulatorAPI::EmulatorAPI(IStockApi &datasrc, double initial_currency):datasrc(datasrc)
+EmulatorAPI::EmulatorAPI(IStockApi &datasrc, double initial_currency, const FillModel_Config &fmcfg):datasrc(datasrc)
 	,prevId(std::chrono::duration_cast<std::chrono::milliseconds>(
 				std::chrono::system_clock::now().time_since_epoch()
 				).count())
+	,fillModel(fmcfg)
 	,initial_currency(initial_currency)
 	,log("emulator")
 {
@@ -101,7 +103,7 @@ json::Value EmulatorAPI::placeOrder(const std::string_view & pair,
 	}
 
 
-	Order order{genID(), clientId, size, price};
+	EmulOrder order{Order{genID(), clientId, size, price}, fillModel.place(lastTicker.time)};
 
 	if (replaceId.defined()) {
 		auto iter = std::find_if(orders.begin(), orders.end(), [&](const Order &o){
@@ -138,7 +140,7 @@ EmulatorAPI::MarketInfo EmulatorAPI::getMarketInfo(const std::string_view & pair
 
 
 double EmulatorAPI::getFees(const std::string_view &pair) {
-	minfo.fees = datasrc.getFees(pair);
+	minfo.fees = fillModel.getFees(datasrc.getFees(pair));
 	return minfo.fees;
 }
 
@@ -163,46 +165,57 @@ std::string EmulatorAPI::getIconName() const {
 
 void EmulatorAPI::simulation(const Ticker &tk) {
 
-	double cur = tk.last;
-	Orders left_orders;
+	std::uint64_t elapsed = lastSimTime && tk.time > lastSimTime?tk.time - lastSimTime:0;
+	lastSimTime = tk.time;
+
+	std::vector<EmulOrder> left_orders;
 	for (auto &&o: orders) {
 
-		double diffp = cur - o.price;
-		double sm = diffp * o.size;
-		if (sm > 0) {
-			left_orders.push_back(std::move(o));
-		} else {
-			auto tm = tk.time;
-
-			IStockApi::Trade tr {
-				json::Value(json::String({prefix,std::to_string(genID())})),
-				tm,
-				o.size,
-				o.price,
-				o.size,
-				o.price
-			};
-			minfo.removeFees(tr.eff_size, tr.eff_price);
-			trades.push_back(tr);
-			ondra_shared::logInfo("Emulator Trade: $1 on $2", o.size, o.price);
-			if (minfo.leverage > 0) {
-				if (balance) {
-					double open_price = margin_currency / balance;
-					double price_diff = o.price - open_price;
-					currency += balance * price_diff;
-				}
-				margin_currency += margin_currency - tr.size * tr.price;
-			} else {
-				currency -= tr.size * tr.eff_price;
+		double filled = fillModel.fill(o.fstate, o.size, o.price, tk, elapsed);
+		if (filled) {
+			double rest = o.size - filled;
+			//don't leave dust on orderbook
+			if (std::abs(rest) < std::max(minfo.min_size, minfo.asset_step)) {
+				filled = o.size;
+				rest = 0;
 			}
-			balance +=tr.eff_size;
+			executeTrade(o, filled, tk.time);
+			if (rest == 0) continue;
+			o.size = rest;
 		}
-
+		left_orders.push_back(std::move(o));
 	}
 
 	std::swap(orders, left_orders);
 }
 
+void EmulatorAPI::executeTrade(const Order &o, double size, std::uint64_t time) {
+
+	IStockApi::Trade tr {
+		json::Value(json::String({prefix,std::to_string(genID())})),
+		time,
+		size,
+		o.price,
+		size,
+		o.price
+	};
+	fillModel.addVolume(time, size * o.price);
+	minfo.removeFees(tr.eff_size, tr.eff_price);
+	trades.push_back(tr);
+	ondra_shared::logInfo("Emulator Trade: $1 on $2", size, o.price);
+	if (minfo.leverage > 0) {
+		if (balance) {
+			double open_price = margin_currency / balance;
+			double price_diff = o.price - open_price;
+			currency += balance * price_diff;
+		}
+		margin_currency += margin_currency - tr.size * tr.price;
+	} else {
+		currency -= tr.size * tr.eff_price;
+	}
+	balance +=tr.eff_size;
+}
+
 bool EmulatorAPI::reset() {
 	if (!datasrc.reset()) return false;
 	if (!pair.empty()) getTicker(pair);
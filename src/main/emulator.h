@@ -10,6 +10,7 @@
 #include <optional>
 
 #include "../shared/logOutput.h"
+#include "fillmodel.h"
 #include "ibrokercontrol.h"
 #include "istockapi.h"
 
@@ -18,7 +19,7 @@
 class EmulatorAPI: public IStockApi, public IBrokerIcon {
 public:
 
-	EmulatorAPI(IStockApi &datasrc, double initial_currency);
+	EmulatorAPI(IStockApi &datasrc, double initial_currency, const FillModel_Config &fmcfg = FillModel_Config());
 
 
 	virtual double getBalance(const std::string_view & symb, const std::string_view & pair) override;
@@ -47,9 +48,15 @@ protected:
 
 	std::size_t genID();
 
-	Orders orders;
+	struct EmulOrder: public Order {
+		FillModel::OrderState fstate;
+	};
+
+	std::vector<EmulOrder> orders;
 	TradeHistory trades;
 	Ticker lastTicker;
+	std::uint64_t lastSimTime = 0;
+	FillModel fillModel;
 
 	std::string balance_symb;
 	std::string currency_symb;
@@ -69,6 +76,7 @@ protected:
 	ondra_shared::LogObject log;
 
 	void simulation(const Ticker &tk);
+	void executeTrade(const Order &o, double size, std::uint64_t time);
 
 };
 
@@ -12,6 +12,8 @@
 
 #include <imtjson/object.h>
 #include <imtjson/binary.h>
+#include <atomic>
+#include <chrono>
 #include <fstream>
 #include <set>
 
@@ -85,35 +87,27 @@ json::Value  ExtStockApi::placeOrder(const std::string_view & pair,
 }
 
 
+static std::atomic<std::uint64_t> resetRound{1};
+
+void ExtStockApi::beginResetRound() {
+	resetRound++;
+}
+
 bool ExtStockApi::reset() {
 	std::unique_lock _(connection->getLock());
+	json::Value round = resetRound.load();
 	//save housekeep counter to avoid reset treat as action
 	if (connection->isActive()) try {
-		requestExchange("reset",json::Value(),true);
+		requestExchange("reset",round,true);
 	} catch (...) {
-		requestExchange("reset",json::Value(),true);
+		requestExchange("reset",round,true);
 	}
 	return true;
 }
 
 ExtStockApi::MarketInfo ExtStockApi::getMarketInfo(const std::string_view & pair) {
 	json::Value v = requestExchange("getInfo",StrViewA(pair));
-
-	MarketInfo res;
-	res.asset_step = v["asset_step"].getNumber();
-	res.currency_step = v["currency_step"].getNumber();
-	res.asset_symbol = v["asset_symbol"].getString();
-	res.currency_symbol = v["currency_symbol"].getString();
-	res.min_size = v["min_size"].getNumber();
-	res.min_volume= v["min_volume"].getNumber();
-	res.fees = v["fees"].getNumber();
-	res.feeScheme = strFeeScheme[v["feeScheme"].getString()];
-	res.leverage= v["leverage"].getNumber();
-	res.invert_price= v["invert_price"].getBool();
-	res.simulator= v["simulator"].getBool();
-	res.inverted_symbol= v["inverted_symbol"].getString();
-	return res;
-
+	return MarketInfo::fromJSON(v);
 }
 
 double ExtStockApi::getFees(const std::string_view& pair) {
@@ -138,6 +132,7 @@ void ExtStockApi::Connection::onConnect() {
 	} catch (AbstractExtern::Exception &) {
 
 	}
+	if (instance_counter) telemetry.recordRestart();
 	instance_counter++;
 }
 
@@ -248,10 +243,41 @@ ExtStockApi::PageData ExtStockApi::fetchPage(const std::string_view &method,
 }
 
 json::Value ExtStockApi::requestExchange(json::String name, json::Value args, bool idle) {
-	if (connection->wasRestarted(instance_counter)) {
-		if (broker_config.defined()) {
-			if (subaccount.empty()) connection->jsonRequestExchange("restoreSettings", broker_config, idle);
-			else connection->jsonRequestExchange("subaccount", {subaccount, "restoreSettings", broker_config}, idle);
+	//wait for rate limit first, so requests of higher priority can overtake
+	connection->limiter.acquire(std::string_view(name.c_str(), name.length()));
+	//requests of other threads can be pending, so traffic is measured per thread
+	AbstractExtern::CallStats &cs = AbstractExtern::threadCallStats();
+	cs = AbstractExtern::CallStats();
+	auto start = std::chrono::steady_clock::now();
+	auto record = [&](bool error) {
+		connection->telemetry.record(std::string_view(name.c_str(), name.length()), BrokerTelemetry::Sample{
+			static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+					std::chrono::steady_clock::now() - start).count()),
+			error,
+			cs.timeout,
+			cs.bytesOut,
+			cs.bytesIn
+		});
+	};
+	try {
+		json::Value r = requestExchangeNoStats(name, args, idle);
+		record(false);
+		return r;
+	} catch (...) {
+		record(true);
+		throw;
+	}
+}
+
+json::Value ExtStockApi::requestExchangeNoStats(json::String name, json::Value args, bool idle) {
+	{
+		//other requests of this instance must wait until settings are restored
+		std::unique_lock _(restoreLock);
+		if (connection->wasRestarted(instance_counter)) {
+			if (broker_config.defined()) {
+				if (subaccount.empty()) connection->jsonRequestExchange("restoreSettings", broker_config, idle);
+				else connection->jsonRequestExchange("subaccount", {subaccount, "restoreSettings", broker_config}, idle);
+			}
 		}
 	}
 	if (subaccount.empty()) return connection->jsonRequestExchange(name, args, idle);
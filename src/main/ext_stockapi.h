@@ -12,6 +12,8 @@
 #include "abstractExtern.h"
 #include "apikeys.h"
 #include "ibrokercontrol.h"
+#include "ratelimit.h"
+#include "telemetry.h"
 
 
 
@@ -31,6 +33,11 @@ public:
 			double size, double price,json::Value clientId,
 			json::Value replaceId,double replaceSize) override;
 	virtual bool reset() override;
+	///Starts new reset round
+	/** Brokers reset in the same round share public data downloaded in this round
+	 * (subaccounts of the broker). Call it once before brokers of the cycle are reset
+	 */
+	static void beginResetRound();
 	virtual MarketInfo getMarketInfo(const std::string_view & pair) override;
 	virtual double getFees(const std::string_view & pair) override;
 	virtual std::vector<std::string> getAllPairs() override;
@@ -48,6 +55,16 @@ public:
 	void stop();
 	virtual ExtStockApi *createSubaccount(const std::string &subaccount) const override;
 	virtual bool isSubaccount() const override;
+	///Telemetry of the broker process (shared with subaccounts)
+	const BrokerTelemetry &getTelemetry() const {return connection->telemetry;}
+	///Limits weight of requests per minute (shared with subaccounts). Zero disables limit
+	void setRateLimit(unsigned int weightPerMinute) {connection->limiter.setLimit(weightPerMinute);}
+	///Keeps spare broker process ready to replace crashed broker (shared with subaccounts)
+	void setStandby(bool enable) {connection->setStandby(enable);}
+	///Retrieves events sent by the broker (subaccount doesn't receive events)
+	std::vector<json::Value> collectEvents() {
+		if (subaccount.empty()) return connection->collectEvents(); else return {};
+	}
 
 
 
@@ -60,6 +77,8 @@ protected:
 		const std::string &getName() const {return this->name;}
 		std::recursive_mutex &getLock() const {return lock;}
 		bool isActive() const {return this->chldid != -1;}
+		BrokerTelemetry telemetry;
+		RequestRateLimiter limiter;
 	protected:
 		std::atomic<int> instance_counter = 0;
 	};
@@ -68,8 +87,12 @@ protected:
 	std::shared_ptr<Connection> connection;
 	int instance_counter = 0;
 	std::string subaccount;
+	///serializes detection of the restart and restoring the settings
+	std::mutex restoreLock;
 
 	ExtStockApi(std::shared_ptr<Connection> connection, const std::string &subaccid);
+
+	json::Value requestExchangeNoStats(json::String name, json::Value args, bool idle);
 };
 
 
@@ -7,6 +7,11 @@
 
 #include "ext_storage.h"
 
+#include <algorithm>
+#include <stdexcept>
+#include <imtjson/array.h>
+#include <imtjson/object.h>
+
 ExtStorage::ExtStorage(const std::string_view &workingDir,
 		const std::string_view &name, const std::string_view &cmdline, int timeout)
 :proxy(new Proxy(workingDir, name, cmdline, timeout))
@@ -16,11 +21,32 @@ PStorage ExtStorage::create(std::string name) const {
 	return PStorage(new Handle(name, proxy));
 }
 
+ExtStorage::Proxy::Proxy(const std::string_view &workingDir,
+		const std::string_view &name, const std::string_view &cmdline, int timeout)
+:AbstractExtern(workingDir, name, cmdline, timeout)
+{
+	thr = std::thread([this]{worker();});
+}
+
+void ExtStorage::Proxy::checkDelivery() const {
+	if (!lastError.empty()) throw std::runtime_error("Storage is not available: " + lastError);
+}
+
 void ExtStorage::Proxy::store(const std::string &name, const json::Value &data) {
-	jsonRequestExchange("store", {name, data});
+	std::unique_lock _(wlock);
+	pending[name] = data;
+	wcond.notify_all();
+	checkDelivery();
 }
 
 json::Value ExtStorage::Proxy::load(const std::string &name) {
+	{
+		std::unique_lock _(wlock);
+		auto iter = pending.find(name);
+		if (iter != pending.end()) return iter->second;
+		iter = inflight.find(name);
+		if (iter != inflight.end()) return iter->second;
+	}
 	try {
 		return jsonRequestExchange("load", name);
 	} catch (...) {
@@ -29,7 +55,92 @@ json::Value ExtStorage::Proxy::load(const std::string &name) {
 }
 
 void ExtStorage::Proxy::erase(const std::string &name) {
-	jsonRequestExchange("erase", name);
+	std::unique_lock _(wlock);
+	pending[name] = json::undefined;
+	wcond.notify_all();
+	checkDelivery();
+}
+
+bool ExtStorage::Proxy::flush() {
+	std::unique_lock _(wlock);
+	unsigned int f = failures;
+	flushing++;
+	wcond.notify_all();
+	wcond.wait(_, [&]{
+		return stopped || failures != f || (pending.empty() && inflight.empty());
+	});
+	flushing--;
+	return pending.empty() && inflight.empty();
+}
+
+void ExtStorage::Proxy::deliver(const Pending &batch) {
+	if (batchSupported) {
+		json::Array stores;
+		json::Array erases;
+		for (auto &&x: batch) {
+			if (x.second.defined()) stores.push_back({x.first, x.second});
+			else erases.push_back(x.first);
+		}
+		try {
+			jsonRequestExchange("storeMany", json::Object("store", stores)("erase", erases));
+			return;
+		} catch (const AbstractExtern::Exception &e) {
+			if (e.getMsg() != "unsupported function") throw;
+			batchSupported = false;
+		}
+	}
+	for (auto &&x: batch) {
+		if (x.second.defined()) jsonRequestExchange("store", {x.first, x.second});
+		else jsonRequestExchange("erase", x.first);
+	}
+}
+
+void ExtStorage::Proxy::worker() {
+	unsigned int backoff = 0;
+	std::unique_lock _(wlock);
+	while (true) {
+		wcond.wait(_, [&]{return stopped || !pending.empty();});
+		if (pending.empty()) break;
+		//collect more writes, unless somebody waits for them
+		if (!stopped && !flushing) {
+			wcond.wait_for(_, flushDelay, [&]{return stopped || flushing > 0;});
+		}
+		auto iter = pending.begin();
+		for (unsigned int i = 0; i < maxBatch && iter != pending.end(); i++) {
+			inflight.insert(pending.extract(iter++));
+		}
+		_.unlock();
+		bool ok = true;
+		std::string err;
+		try {
+			deliver(inflight);
+		} catch (std::exception &e) {
+			log.error("Failed to deliver data to the storage: $1", e.what());
+			err = e.what();
+			ok = false;
+		}
+		_.lock();
+		lastError = err;
+		if (!ok) {
+			//return undelivered writes, unless they were replaced meanwhile
+			for (auto &&x: inflight) pending.emplace(x.first, x.second);
+			failures++;
+		}
+		inflight.clear();
+		wcond.notify_all();
+		if (ok) {
+			backoff = 0;
+		} else if (stopped) {
+			log.error("Storage is not available, $1 pending write(s) are lost", pending.size());
+			pending.clear();
+			break;
+		} else {
+			backoff = std::min(maxBackoff, std::max(minBackoff, backoff * 2));
+			wcond.wait_for(_, std::chrono::milliseconds(backoff), [&]{return stopped || flushing > 0;});
+		}
+	}
+	stopped = true;
+	wcond.notify_all();
 }
 
 ExtStorage::Handle::Handle(std::string name, ondra_shared::RefCntPtr<Proxy> proxy)
@@ -51,7 +162,14 @@ void ExtStorage::Handle::erase() {
 }
 
 ExtStorage::~ExtStorage() {
+	proxy->flush();
 }
 
 ExtStorage::Proxy::~Proxy() {
+	{
+		std::unique_lock _(wlock);
+		stopped = true;
+		wcond.notify_all();
+	}
+	thr.join();
 }
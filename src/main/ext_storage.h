@@ -7,10 +7,25 @@
 
 #ifndef SRC_MAIN_EXT_STORAGE_H_
 #define SRC_MAIN_EXT_STORAGE_H_
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
 #include <imtjson/value.h>
 #include "abstractExtern.h"
 #include "istorage.h"
 
+///Storage in the external process (storage_broker)
+/**
+ * Writes are asynchronous. Repeated stores of the same name are coalesced, only the latest
+ * data are sent. Pending data are delivered on the background in batches (command "storeMany").
+ * Reading of a name with pending data returns the pending data. Destruction waits until
+ * everything is delivered
+ *
+ * While the delivery fails, store() and erase() throw exception with the last error, so
+ * the failure is reported to the caller. The data are still kept and delivered later
+ */
 class ExtStorage: public IStorageFactory {
 public:
 
@@ -24,13 +39,53 @@ protected:
 
 	class Proxy: public AbstractExtern, public ondra_shared::RefCntObj {
 	public:
-		using AbstractExtern::AbstractExtern;
+		Proxy(const std::string_view & workingDir, const std::string_view & name, const std::string_view & cmdline, int timeout);
 
+		///Queues the data
+		/** Throws exception, when the previous delivery failed. The data are queued anyway */
 		void store(const std::string &name, const json::Value &data);
 		json::Value load(const std::string &name);
+		///Queues erase
+		/** Throws exception, when the previous delivery failed. The erase is queued anyway */
 		void erase(const std::string &name);
+		///Waits until all pending writes are delivered
+		/**
+		 * @retval true everything delivered
+		 * @retval false delivery failed, data are still pending and will be retried
+		 */
+		bool flush();
 		virtual ~Proxy();
 
+		///max count of documents in single request
+		static constexpr unsigned int maxBatch = 32;
+		///time to collect writes before they are sent
+		static constexpr std::chrono::milliseconds flushDelay{1000};
+		static constexpr unsigned int minBackoff = 1000;
+		static constexpr unsigned int maxBackoff = 60000;
+
+	protected:
+		///pending writes, undefined value means erase
+		using Pending = std::map<std::string, json::Value>;
+
+		std::mutex wlock;
+		std::condition_variable wcond;
+		Pending pending;
+		///writes being delivered
+		Pending inflight;
+		///count of failed deliveries
+		unsigned int failures = 0;
+		///error of the last delivery, empty when it was successful
+		std::string lastError;
+		///count of threads waiting in flush()
+		unsigned int flushing = 0;
+		bool stopped = false;
+		///cleared when broker doesn't support storeMany
+		bool batchSupported = true;
+		std::thread thr;
+
+		void worker();
+		void deliver(const Pending &batch);
+		void checkDelivery() const;
 	};
 
 	class Handle: public IStorage {
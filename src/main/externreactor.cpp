@@ -0,0 +1,290 @@
+/*
+ * externreactor.cpp
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#include "externreactor.h"
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include "binframe.h"
+
+ExternChannel::ExternChannel(const std::string &name, std::atomic<std::uint64_t> *bytesIn)
+	:log(name),bytesIn(bytesIn) {}
+
+std::exception_ptr ExternChannel::lostError() const {
+	return std::make_exception_ptr(std::runtime_error(
+			"Connection to API lost - err: " + (lastStdErr.empty()?std::string("N/A"):lastStdErr)));
+}
+
+std::future<ExternChannel::Reply> ExternChannel::expectReply() {
+	std::lock_guard _(lock);
+	if (closed) {
+		std::promise<Reply> p;
+		p.set_exception(lostError());
+		return p.get_future();
+	}
+	replies.emplace_back();
+	return replies.back().get_future();
+}
+
+std::vector<json::Value> ExternChannel::takeEvents() {
+	std::lock_guard _(lock);
+	std::vector<json::Value> res;
+	res.swap(events);
+	return res;
+}
+
+bool ExternChannel::isClosed() const {
+	std::lock_guard _(lock);
+	return closed;
+}
+
+void ExternChannel::onData(const char *data, std::size_t size) {
+	std::lock_guard _(lock);
+	if (bytesIn) bytesIn->fetch_add(size, std::memory_order_relaxed);
+	//data after the corrupted frame are ignored
+	if (closed) return;
+	inbuf.append(data, size);
+	processInput();
+}
+
+void ExternChannel::onStdErr(const char *data, std::size_t size) {
+	std::lock_guard _(lock);
+	errbuf.append(data, size);
+	std::size_t p = errbuf.find('\n');
+	while (p != errbuf.npos) {
+		lastStdErr = errbuf.substr(0, p);
+		log.note("stderr: $1", lastStdErr);
+		errbuf.erase(0, p+1);
+		p = errbuf.find('\n');
+	}
+	//very long line is logged in parts
+	if (errbuf.size() > 65536) {
+		lastStdErr = std::move(errbuf);
+		log.note("stderr: $1", lastStdErr);
+		errbuf.clear();
+	}
+}
+
+void ExternChannel::onClose() {
+	std::lock_guard _(lock);
+	closeLocked();
+}
+
+void ExternChannel::closeLocked() {
+	if (closed) return;
+	closed = true;
+	if (!errbuf.empty()) {
+		lastStdErr = std::move(errbuf);
+		log.note("stderr: $1", lastStdErr);
+		errbuf.clear();
+	}
+	for (auto &p: replies) p.set_exception(lostError());
+	replies.clear();
+}
+
+namespace {
+	///thrown by the parser's source, when the message is not complete yet
+	struct NeedMoreData {};
+}
+
+void ExternChannel::processInput() {
+	while (true) {
+		std::size_t p = inbuf.find_first_not_of(" \t\r\n");
+		if (p == inbuf.npos) {
+			inbuf.clear();
+			scanPos = 0;
+			return;
+		}
+		if (p) {
+			inbuf.erase(0, p);
+			scanPos = scanPos > p?scanPos-p:0;
+		}
+		if (inbuf[0] == BinaryFrame::marker) {
+			if (inbuf.size() < 1 + BinaryFrame::lengthSize) return;
+			std::size_t len;
+			try {
+				len = BinaryFrame::decodeLength(inbuf.data()+1);
+			} catch (std::exception &e) {
+				//stream can't be resynchronized, the process is killed by the owner
+				log.error("Invalid message from the process: $1", e.what());
+				inbuf.clear();
+				scanPos = 0;
+				closeLocked();
+				return;
+			}
+			std::size_t total = 1 + BinaryFrame::lengthSize + len;
+			if (inbuf.size() < total) return;
+			json::Value v;
+			try {
+				v = BinaryFrame::decode(std::string_view(inbuf.data() + 1 + BinaryFrame::lengthSize, len));
+			} catch (std::exception &e) {
+				log.error("Invalid message from the process: $1", e.what());
+			}
+			inbuf.erase(0, total);
+			scanPos = 0;
+			if (v.defined()) dispatch(v, total);
+		} else {
+			//text messages end by new line, but the message can span multiple lines
+			std::size_t nl = inbuf.find('\n', scanPos);
+			if (nl == inbuf.npos) {
+				scanPos = inbuf.size();
+				return;
+			}
+			std::size_t end = nl+1;
+			std::size_t pos = 0;
+			json::Value v;
+			try {
+				v = json::Value::parse([&]()->int{
+					if (pos >= end) throw NeedMoreData();
+					return static_cast<unsigned char>(inbuf[pos++]);
+				});
+			} catch (const NeedMoreData &) {
+				scanPos = end;
+				continue;
+			} catch (std::exception &e) {
+				log.error("Invalid message from the process: $1", e.what());
+				pos = end;
+			}
+			inbuf.erase(0, pos);
+			scanPos = 0;
+			if (v.defined()) dispatch(v, pos);
+		}
+	}
+}
+
+void ExternChannel::dispatch(json::Value msg, std::size_t bytes) {
+	json::Value t = msg[0];
+	if (t.type() == json::string && t.getString() == "event") {
+		events.push_back(msg[1]);
+	} else if (!replies.empty()) {
+		replies.front().set_value(Reply{msg, bytes});
+		replies.pop_front();
+	} else {
+		log.warning("Unexpected message from the process: $1", msg.toString().substr(0,512));
+	}
+}
+
+ExternReactor &ExternReactor::getInstance() {
+	static ExternReactor reactor;
+	return reactor;
+}
+
+ExternReactor::ExternReactor() {
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (epfd == -1) throw std::runtime_error(std::string("epoll_create1: ") + strerror(errno));
+	wakefd = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK);
+	if (wakefd == -1) throw std::runtime_error(std::string("eventfd: ") + strerror(errno));
+	epoll_event ev = {};
+	ev.events = EPOLLIN;
+	ev.data.u64 = 0;
+	epoll_ctl(epfd, EPOLL_CTL_ADD, wakefd, &ev);
+	thr = std::thread([this]{worker();});
+}
+
+ExternReactor::~ExternReactor() {
+	{
+		std::lock_guard _(lock);
+		stopped = true;
+		std::uint64_t one = 1;
+		if (::write(wakefd, &one, sizeof(one)) < 0) {}
+	}
+	thr.join();
+	::close(wakefd);
+	::close(epfd);
+}
+
+std::uint64_t ExternReactor::add(int out, int err, PExternChannel channel) {
+	std::lock_guard _(lock);
+	std::uint64_t id = nextId++;
+	for (int fd: {out, err}) {
+		int flags = fcntl(fd, F_GETFL);
+		fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+	}
+	epoll_event ev = {};
+	ev.events = EPOLLIN;
+	//lowest bit distinguishes stderr
+	ev.data.u64 = id * 2;
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, out, &ev) == -1)
+		throw std::runtime_error(std::string("epoll_ctl: ") + strerror(errno));
+	ev.data.u64 = id * 2 + 1;
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, err, &ev) == -1) {
+		int e = errno;
+		unregisterFd(out);
+		throw std::runtime_error(std::string("epoll_ctl: ") + strerror(e));
+	}
+	regs.emplace(id, Reg{out, err, std::move(channel)});
+	return id;
+}
+
+void ExternReactor::remove(std::uint64_t id) {
+	std::lock_guard _(lock);
+	auto iter = regs.find(id);
+	if (iter == regs.end()) return;
+	if (iter->second.out >= 0) unregisterFd(iter->second.out);
+	if (iter->second.err >= 0) unregisterFd(iter->second.err);
+	regs.erase(iter);
+}
+
+void ExternReactor::unregisterFd(int fd) {
+	epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+void ExternReactor::worker() {
+	epoll_event evs[32];
+	std::vector<char> buff(65536);
+	while (true) {
+		int n = epoll_wait(epfd, evs, 32, -1);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			break;
+		}
+		//data are read under the lock, so remove() guarantees, that the pipe is no longer read
+		std::lock_guard _(lock);
+		if (stopped) break;
+		for (int i = 0; i < n; i++) {
+			std::uint64_t key = evs[i].data.u64;
+			if (key == 0) {
+				std::uint64_t v;
+				if (::read(wakefd, &v, sizeof(v)) < 0) {}
+				continue;
+			}
+			auto iter = regs.find(key/2);
+			if (iter == regs.end()) continue;
+			Reg &r = iter->second;
+			bool isErr = (key & 1) != 0;
+			int &fd = isErr?r.err:r.out;
+			if (fd < 0) continue;
+			bool eof = false;
+			while (true) {
+				ssize_t rd = ::read(fd, buff.data(), buff.size());
+				if (rd > 0) {
+					if (isErr) r.channel->onStdErr(buff.data(), rd);
+					else r.channel->onData(buff.data(), rd);
+					if (static_cast<std::size_t>(rd) < buff.size()) break;
+				} else if (rd == 0) {
+					eof = true;
+					break;
+				} else if (errno == EINTR) {
+					continue;
+				} else {
+					eof = errno != EAGAIN && errno != EWOULDBLOCK;
+					break;
+				}
+			}
+			if (eof) {
+				unregisterFd(fd);
+				fd = -1;
+				if (!isErr) r.channel->onClose();
+			}
+		}
+	}
+}
@@ -0,0 +1,132 @@
+/*
+ * externreactor.h
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#ifndef SRC_MAIN_EXTERNREACTOR_H_
+#define SRC_MAIN_EXTERNREACTOR_H_
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <imtjson/value.h>
+
+#include "../shared/logOutput.h"
+
+///Incoming side of the connection to an external process
+/**
+ * Reactor feeds the channel with data from stdout and stderr of the process. The channel
+ * splits the data to messages (text line or binary frame) and delivers
+ * the reply to the caller waiting on the future. Events are queued. Lines of stderr are
+ * logged as they arrive.
+ *
+ * More requests can be pending. The process replies in order of the requests, so
+ * replies are assigned to the futures in order in which they were prepared
+ */
+class ExternChannel {
+public:
+	ExternChannel(const std::string &name, std::atomic<std::uint64_t> *bytesIn);
+
+	struct Reply {
+		json::Value msg;
+		///size of the message in bytes
+		std::size_t bytes;
+	};
+
+	///Prepares the future for the next reply. Must be called before the request is sent
+	std::future<Reply> expectReply();
+	///Retrieves events received so far
+	std::vector<json::Value> takeEvents();
+	///Returns true when stdout of the process has been closed
+	bool isClosed() const;
+
+	///Called by the reactor - data from stdout
+	void onData(const char *data, std::size_t size);
+	///Called by the reactor - data from stderr
+	void onStdErr(const char *data, std::size_t size);
+	///Called by the reactor or the owner - process closed stdout or it was killed
+	void onClose();
+
+protected:
+	mutable std::mutex lock;
+	ondra_shared::LogObject log;
+	std::atomic<std::uint64_t> *bytesIn;
+	std::string inbuf;
+	///position in inbuf, where search of the end of text message continues
+	std::size_t scanPos = 0;
+	std::string errbuf;
+	std::string lastStdErr;
+	std::deque<std::promise<Reply> > replies;
+	std::vector<json::Value> events;
+	bool closed = false;
+
+	void processInput();
+	void dispatch(json::Value msg, std::size_t bytes);
+	///Marks the channel closed and fails pending replies (lock must be held)
+	void closeLocked();
+	std::exception_ptr lostError() const;
+};
+
+using PExternChannel = std::shared_ptr<ExternChannel>;
+
+///Single thread which reads pipes of all external processes (brokers, strategies, storage, ...)
+/**
+ * The reactor uses epoll. Read ends of the pipes are switched to non-blocking mode
+ * when they are registered. Data are delivered to the channels, so no thread is blocked
+ * while an external process is working, and stderr is drained even if there is no
+ * pending request
+ */
+class ExternReactor {
+public:
+
+	///Retrieves reactor shared in the process
+	static ExternReactor &getInstance();
+
+	ExternReactor();
+	~ExternReactor();
+
+	///Registers stdout and stderr of the process
+	/**
+	 * @param out stdout of the process
+	 * @param err stderr of the process
+	 * @param channel channel which receives data
+	 * @return registration id
+	 */
+	std::uint64_t add(int out, int err, PExternChannel channel);
+	///Unregisters the process
+	/** After return, the channel doesn't receive any data. Pipes must be unregistered
+	 * before they are closed
+	 */
+	void remove(std::uint64_t id);
+
+protected:
+
+	struct Reg {
+		int out;
+		int err;
+		PExternChannel channel;
+	};
+
+	std::mutex lock;
+	int epfd = -1;
+	int wakefd = -1;
+	std::uint64_t nextId = 1;
+	std::unordered_map<std::uint64_t, Reg> regs;
+	std::thread thr;
+	bool stopped = false;
+
+	void worker();
+	void unregisterFd(int fd);
+};
+
+
+
+#endif /* SRC_MAIN_EXTERNREACTOR_H_ */
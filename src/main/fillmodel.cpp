@@ -0,0 +1,87 @@
+/*
+ * fillmodel.cpp
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#include "fillmodel.h"
+
+#include <algorithm>
+#include <cmath>
+#include "sgn.h"
+
+json::NamedEnum<FillModel_Config::Type> strFillModelType ({
+	{FillModel_Config::instant, "instant"},
+	{FillModel_Config::queue, "queue"}
+});
+
+///Period used to calculate volume for fee tiers (30 days)
+static const std::uint64_t feeTierPeriod = 30*24*3600*std::uint64_t(1000);
+
+void FillModel_Config::loadConfig(json::Value data) {
+	type = strFillModelType[data["model"].getValueOrDefault("instant")];
+	latency = data["latency"].getUIntLong();
+	volume = data["volume"].getNumber();
+	queue = data["queue"].getNumber();
+	sweep = data["sweep"].getValueOrDefault(0.001);
+	fee_tiers.clear();
+	for (json::Value t: data["fee_tiers"]) {
+		fee_tiers.push_back(FeeTier{t[0].getNumber(), t[1].getNumber()});
+	}
+	std::sort(fee_tiers.begin(), fee_tiers.end(), [](const FeeTier &a, const FeeTier &b) {
+		return a.volume < b.volume;
+	});
+
+	if (volume < 0) throw std::runtime_error("'emulator.volume' must not be negative");
+	if (queue < 0) throw std::runtime_error("'emulator.queue' must not be negative");
+	if (sweep < 0) throw std::runtime_error("'emulator.sweep' must not be negative");
+}
+
+FillModel::OrderState FillModel::place(std::uint64_t time) const {
+	return OrderState{time+cfg.latency, cfg.queue};
+}
+
+double FillModel::fill(OrderState &st, double size, double price, const IStockApi::Ticker &tk, std::uint64_t elapsed) const {
+	//price didn't cross the order
+	if ((tk.last - price) * size > 0) return 0;
+	//order is not on orderbook yet
+	if (tk.time < st.active_from) return 0;
+	if (cfg.type == Config::instant) return size;
+
+	double penetration = std::abs(tk.last - price)/price;
+	if (penetration >= cfg.sweep || cfg.volume <= 0) return size;
+
+	//count only time when order was on orderbook
+	elapsed = std::min(elapsed, tk.time - st.active_from);
+	double avail = cfg.volume * elapsed / 60000.0;
+	double q = std::min(st.queue, avail);
+	st.queue -= q;
+	avail -= q;
+	return std::min(avail, std::abs(size)) * sgn(size);
+}
+
+double FillModel::fillAtPrice(double size, std::uint64_t elapsed) const {
+	if (elapsed < cfg.latency) return 0;
+	if (cfg.type == Config::instant || cfg.volume <= 0) return size;
+	double avail = cfg.volume * (elapsed - cfg.latency) / 60000.0 - cfg.queue;
+	if (avail <= 0) return 0;
+	return std::min(avail, std::abs(size)) * sgn(size);
+}
+
+void FillModel::addVolume(std::uint64_t time, double volume) {
+	if (cfg.fee_tiers.empty()) return;
+	volumeHist.push_back(VolumeRec{time, std::abs(volume)});
+	volumeSum += std::abs(volume);
+	while (!volumeHist.empty() && volumeHist.front().time + feeTierPeriod < time) {
+		volumeSum -= volumeHist.front().volume;
+		volumeHist.pop_front();
+	}
+}
+
+double FillModel::getFees(double fees) const {
+	for (auto &&t: cfg.fee_tiers) {
+		if (t.volume > volumeSum) break;
+		fees = t.fees;
+	}
+	return fees;
+}
@@ -0,0 +1,119 @@
+/*
+ * fillmodel.h
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#ifndef SRC_MAIN_FILLMODEL_H_
+#define SRC_MAIN_FILLMODEL_H_
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include <imtjson/value.h>
+#include <imtjson/namedEnum.h>
+#include "istockapi.h"
+
+struct FillModel_Config {
+
+	enum Type {
+		///Order is filled completely once the price crosses its price (legacy behaviour)
+		instant,
+		///Order waits in the queue and it is filled partially from estimated volume
+		queue
+	};
+
+	struct FeeTier {
+		///Minimal 30-days volume (in currency) to activate this tier
+		double volume;
+		///Fees for this tier
+		double fees;
+	};
+
+	Type type = instant;
+	///Delay (in milliseconds) between placing the order and its appearance on the orderbook (both types)
+	std::uint64_t latency = 0;
+	///Estimated volume (in assets) traded at the price level per minute. Zero is unlimited
+	double volume = 0;
+	///Volume (in assets) in front of the order when the order is placed
+	double queue = 0;
+	///Relative price penetration which fills the order completely regardless on volume
+	double sweep = 0.001;
+	///Fee tiers ordered by volume. Empty list means, that fees from the broker are used
+	std::vector<FeeTier> fee_tiers;
+
+	void loadConfig(json::Value data);
+};
+
+extern json::NamedEnum<FillModel_Config::Type> strFillModelType;
+
+///Simulates how orders are filled on the exchange
+/** Used by EmulatorAPI and backtest. All operations are O(1) (amortized), so the model
+ * is suitable for long backtests on minute data
+ */
+class FillModel {
+public:
+
+	using Config = FillModel_Config;
+
+	///State of single order tracked by the model
+	struct OrderState {
+		///Time when order appears on the orderbook
+		std::uint64_t active_from = 0;
+		///Volume remaining in front of the order
+		double queue = 0;
+	};
+
+	FillModel(const Config &cfg):cfg(cfg) {}
+
+	///Creates state for newly placed order
+	/**
+	 * @param time time of placement (in milliseconds)
+	 * @return state of the order
+	 */
+	OrderState place(std::uint64_t time) const;
+
+	///Calculates fill of the order in the emulator
+	/**
+	 * @param st state of the order
+	 * @param size remaining size of the order (negative sell, positive buy)
+	 * @param price price of the order
+	 * @param tk current ticker
+	 * @param elapsed milliseconds ellapsed from previous evaluation
+	 * @return filled size (sign is same as size). Returns 0 if nothing has been filled
+	 */
+	double fill(OrderState &st, double size, double price, const IStockApi::Ticker &tk, std::uint64_t elapsed) const;
+
+	///Calculates fill of the order in the backtest
+	/** In the backtest, the order is always placed at traded price, so it only
+	 * limits size of the fill by the volume and latency
+	 *
+	 * @param size size of the order
+	 * @param elapsed milliseconds ellapsed from previous trade
+	 * @return filled size
+	 */
+	double fillAtPrice(double size, std::uint64_t elapsed) const;
+
+	///Records traded volume - used to determine fee tier
+	void addVolume(std::uint64_t time, double volume);
+	///Retrieves fees for current fee tier
+	/**
+	 * @param fees fees reported by the broker
+	 * @return fees of the tier, or argument if there are no tiers
+	 */
+	double getFees(double fees) const;
+
+protected:
+	Config cfg;
+
+	struct VolumeRec {
+		std::uint64_t time;
+		double volume;
+	};
+
+	std::deque<VolumeRec> volumeHist;
+	double volumeSum = 0;
+};
+
+
+#endif /* SRC_MAIN_FILLMODEL_H_ */
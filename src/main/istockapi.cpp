@@ -119,6 +119,39 @@ void IStockApi::MarketInfo::removeFees(double &assets, double &price) const {
 	}
 }
 
+IStockApi::MarketInfo IStockApi::MarketInfo::fromJSON(json::Value v) {
+	MarketInfo res;
+	res.asset_step = v["asset_step"].getNumber();
+	res.currency_step = v["currency_step"].getNumber();
+	res.asset_symbol = v["asset_symbol"].getString();
+	res.currency_symbol = v["currency_symbol"].getString();
+	res.min_size = v["min_size"].getNumber();
+	res.min_volume= v["min_volume"].getNumber();
+	res.fees = v["fees"].getNumber();
+	res.feeScheme = strFeeScheme[v["feeScheme"].getString()];
+	res.leverage= v["leverage"].getNumber();
+	res.invert_price= v["invert_price"].getBool();
+	res.simulator= v["simulator"].getBool();
+	res.inverted_symbol= v["inverted_symbol"].getString();
+	return res;
+}
+
+json::Value IStockApi::MarketInfo::toJSON() const {
+	return json::Object
+			("asset_step",asset_step)
+			("currency_step", currency_step)
+			("asset_symbol",asset_symbol)
+			("currency_symbol", currency_symbol)
+			("min_size", min_size)
+			("min_volume", min_volume)
+			("fees", fees)
+			("feeScheme",strFeeScheme[feeScheme])
+			("leverage", leverage)
+			("invert_price", invert_price)
+			("inverted_symbol", inverted_symbol)
+			("simulator", simulator);
+}
+
 IStockApi::TradeWithBalance IStockApi::TradeWithBalance::fromJSON(json::Value v) {
 	json::Value jbal = v["bal"];
 	json::Value jman = v["man"];
@@ -165,6 +165,9 @@ public:
 		void addFees(double &assets, double &price) const;
 		void removeFees(double &assets, double &price) const;
 
+		static MarketInfo fromJSON(json::Value v);
+		json::Value toJSON() const;
+
 		template<typename Fn>
 		static double adjValue(double value, double step, Fn &&fn)  {
 			if (step == 0) return value;
@@ -36,15 +36,17 @@ using PStorageFactory = std::unique_ptr<IStorageFactory>;
 ///Two storages, first is primary, other is secondary
 /**
  *  The object reads from primary and in case of failure, secondary is used
- *  Writing is done to both storages while only one can be sucessful
+ *  Writing is done to both storages while only one can be sucessful. Secondary is
+ *  written first, so it holds the latest data even if the primary delivers its writes later.
+ *  Error of the primary storage is passed to the caller
  */
 class BackedStorage: public IStorage {
 public:
 	BackedStorage(PStorage &&primary, PStorage &&secondary):primary(std::move(primary)),secondary(std::move(secondary)) {}
 
 	virtual void store(json::Value data) {
-		try {primary->store(data);} catch (...) {secondary->store(data);throw;}
 		try {secondary->store(data);} catch (...) {}
+		primary->store(data);
 	}
 	virtual json::Value load() {
 		try {
@@ -3,8 +3,10 @@
 #include <shared/stdLogFile.h>
 #include <shared/default_app.h>
 #include <algorithm>
+#include <iomanip>
 #include <iostream>
 #include <sstream>
+#include <thread>
 
 #include "../server/src/simpleServer/abstractStream.h"
 #include "../server/src/simpleServer/address.h"
@@ -129,6 +131,39 @@ static int cmd_singlecmd(Worker &wrk, simpleServer::ArgList args, std::ostream &
 	}
 }
 
+static void printProfile(std::ostream &stream, StrViewA ident, const PhaseProfiler &profiler) {
+	stream << ident << std::endl;
+	json::Value prof = profiler.toJSON();
+	if (prof.empty()) {
+		stream << "\t(no data)" << std::endl;
+		return;
+	}
+	stream << "\t" << std::left << std::setw(18) << "phase" << std::right
+			<< std::setw(12) << "p50 ms" << std::setw(12) << "p99 ms" << std::setw(12) << "max ms"
+			<< std::setw(10) << "count" << std::endl;
+	for (json::Value x: prof) {
+		stream << "\t" << std::left << std::setw(18) << std::string(x["phase"].getString()) << std::right << std::fixed << std::setprecision(3)
+				<< std::setw(12) << x["p50"].getNumber() << std::setw(12) << x["p99"].getNumber() << std::setw(12) << x["max"].getNumber()
+				<< std::setw(10) << x["count"].getUInt() << std::endl;
+	}
+}
+
+static int cmd_profile(simpleServer::ArgList args, std::ostream &stream) {
+	auto trl = traders.lock_shared();
+	if (args.empty()) {
+		trl->enumTraders([&](const auto &t) {
+			printProfile(stream, t.first, t.second.lock_shared()->getProfiler());
+		});
+	} else {
+		auto trader = trl->find(args[0]);
+		if (trader == nullptr) {
+			stream << "Trader idenitification is invalid: " << args[0] << "\n";
+			return 1;
+		}
+		printProfile(stream, args[0], trader.lock_shared()->getProfiler());
+	}
+	return 0;
+}
 
 
 
@@ -171,6 +206,7 @@ public:
 				"reset        - erases all trades expect the last one",
 				"repair       - repair pair",
 				"admin        - generate temporary admin login and password",
+				"profile      - print duration of phases of the trader's cycle. Optional argument: id of trader",
 		};
 
 		const char *intro[] = {
@@ -245,6 +281,13 @@ public:
 						auto listen = servicesection["listen"].getString();
 						auto socket = servicesection["socket"].getPath();
 						auto brk_timeout = servicesection["broker_timeout"].getInt(10000);
+						auto brk_standby = servicesection["broker_standby"].getBool(false);
+						Traders::CycleConfig cycleCfg;
+						cycleCfg.minInterval = servicesection["cycle_min_interval"].getUInt(cycleCfg.minInterval);
+						cycleCfg.maxInterval = std::max(cycleCfg.minInterval, static_cast<unsigned int>(servicesection["cycle_max_interval"].getUInt(cycleCfg.maxInterval)));
+						cycleCfg.brokerBudget = servicesection["broker_cycle_budget"].getUInt(cycleCfg.brokerBudget);
+						cycleCfg.resetInterval = servicesection["broker_reset_interval"].getUInt(cycleCfg.resetInterval);
+						unsigned int preloadThreads = servicesection["preload_threads"].getUInt(std::max(1U, std::thread::hardware_concurrency()));
 						auto rptsect = app.config["report"];
 						auto rptpath = rptsect.mandatory["path"].getPath();
 						auto rptinterval = rptsect["interval"].getUInt(864000000);
@@ -295,6 +338,9 @@ public:
 						traders = traders.make(
 								sch,app.config["brokers"], app.test,sf,rpt,perfmod, rptpath,  brk_timeout
 						);
+						traders.lock()->cycleCfg = cycleCfg;
+						traders.lock()->stockSelector.setRateLimits(app.config["broker_limits"]);
+						traders.lock()->stockSelector.setStandby(brk_standby);
 
 						RefCntPtr<AuthUserList> aul;
 
@@ -388,6 +434,9 @@ public:
 						cntr.on("repair") >> [&](auto &&args, std::ostream &out){
 							return cmd_singlecmd(wrk, args,out,&MTrader::repair);
 						};
+						cntr.on("profile") >> [&](auto &&args, std::ostream &out){
+							return cmd_profile(args, out);
+						};
 						cntr.on("admin") >> [&](auto &&, std::ostream &out){
 							std::random_device rnd;
 							std::uniform_int_distribution<int> dist(33,126);
@@ -408,6 +457,11 @@ public:
 								ondra_shared::AbstractLogProvider::getInstance() = logcap->create();
 							};
 
+							{
+								auto trmap = traders.lock_shared()->traders;
+								Traders::preloadStates(trmap, preloadThreads);
+							}
+
 
 
 							auto report_cycle = [=]() mutable {
@@ -416,24 +470,38 @@ public:
 								rptl->genReport();
 							};
 
+							//each trader has own time of the next cycle, check them every second
 							auto trader_cycle = [=]() mutable {
-								traders.lock()->resetBrokers();
-								traders.lock_shared()->enumTraders([&](const auto & trinfo){
-									sch.immediate()>>[tr = trinfo.second]()mutable{
+								auto trl = traders.lock();
+								trl->processBrokerEvents();
+								std::vector<IStockApi *> brokers;
+								auto due = trl->getDueTraders(brokers);
+								trl.release();
+								Traders::resetBrokers(brokers);
+								for (auto &&t: due) {
+									sch.immediate()>>[ident = t.first, tr = t.second, cycleCfg]()mutable{
+										unsigned int interval = cycleCfg.minInterval;
 										try {
-											tr.lock()->perform(false);
+											auto lt = tr.lock();
+											lt->perform(false);
+											interval = lt->getCycleInterval(cycleCfg.minInterval, cycleCfg.maxInterval);
 										} catch (std::exception &e) {
 											logError("Scheduler exception: $1", e.what());
 										}
+										traders.lock()->finishCycle(ident, interval);
 									};
-								});
-								sch.after(std::chrono::seconds(1)) >> report_cycle;
+								}
+							};
 
+							auto minute_cycle = [=]() mutable {
+								traders.lock()->housekeepingBrokers();
+								report_cycle();
 							};
 
 
 							sch.after(std::chrono::seconds(1)) >> trader_cycle;
-							sch.each(std::chrono::minutes(1)) >> trader_cycle;
+							sch.each(std::chrono::seconds(1)) >> trader_cycle;
+							sch.each(std::chrono::minutes(1)) >> minute_cycle;
 
 
 							return 0;
@@ -80,6 +80,7 @@ void MTrader_Config::loadConfig(json::Value data, bool force_dry_run) {
 	dynmult_scale = data["dynmult_scale"].getValueOrDefault(true);
 	dynmult_sliding = data["dynmult_sliding"].getValueOrDefault(false);
 	dynmult_mult = data["dynmult_mult"].getValueOrDefault(false);
+	fill_model.loadConfig(data["emulator"]);
 
 
 	if (dynmult_raise > 1e6) throw std::runtime_error("'dynmult_raise' is too big");
@@ -129,7 +130,7 @@ IStockApi &MTrader::selectStock(IStockSelector &stock_selector, const Config &co
 	IStockApi *s = stock_selector.getStock(conf.broker);
 	if (s == nullptr) throw std::runtime_error(std::string("Unknown stock market name: ")+std::string(conf.broker));
 	if (conf.dry_run) {
-		ownedStock = std::make_unique<EmulatorAPI>(*s, 0);
+		ownedStock = std::make_unique<EmulatorAPI>(*s, 0, conf.fill_model);
 		return *ownedStock;
 	} else {
 		return *s;
@@ -172,22 +173,36 @@ void MTrader::alertTrigger(Status &st, double price) {
 
 void MTrader::perform(bool manually) {
 
+	PhaseProfiler::Cycle cycle(profiler);
 	try {
 		init();
 
 
 		//Get opened orders
-		auto orders = getOrders();
+		auto orders = [&]{
+			PhaseProfiler::Scope _(PhaseProfiler::getOrders);
+			return getOrders();
+		}();
 		//get current status
-		auto status = getMarketStatus();
+		auto status = [&]{
+			PhaseProfiler::Scope _(PhaseProfiler::getMarketStatus);
+			return getMarketStatus();
+		}();
 
 		std::string buy_order_error;
 		std::string sell_order_error;
 
+		//count of minutes since the last chart item - chart and dynmult expect one step per minute
+		unsigned int minutes = chartMinutes(status.chartItem.time);
+		updateCycleStats(status);
+
 		//update market fees
 		minfo.fees = status.new_fees;
 		//process all new trades
-		bool anytrades = processTrades(status);
+		bool anytrades = [&]{
+			PhaseProfiler::Scope _(PhaseProfiler::processTrades);
+			return processTrades(status);
+		}();
 		bool fast_trade = false;
 		if (anytrades && ((!orders.buy.has_value() && !buy_alert.has_value())
 				|| (!orders.sell.has_value() && !sell_alert.has_value()))) {
@@ -224,11 +239,15 @@ void MTrader::perform(bool manually) {
 				update_dynmult(true,false);
 			}
 			if (!status.new_trades.trades.empty()) {
+				PhaseProfiler::Scope _(PhaseProfiler::processTrades);
 				processTrades(status);
 			}
 
 
-			strategy.onIdle(minfo, status.ticker, status.assetBalance, status.currencyBalance);
+			{
+				PhaseProfiler::Scope _(PhaseProfiler::strategy);
+				strategy.onIdle(minfo, status.ticker, status.assetBalance, status.currencyBalance);
+			}
 
 			if (status.curStep) {
 
@@ -240,43 +259,49 @@ void MTrader::perform(bool manually) {
 					if (!cfg.hidden) statsvc->reportError(IStatSvc::ErrorObj("Automatic trading is disabled"));
 				} else {
 
-						//calculate buy order
-					Order buyorder = calculateOrder(lastTradePrice,
-													  -status.curStep*cfg.buy_step_mult, dynmult.getBuyMult(),
-													   status.ticker.bid, status.assetBalance,
-													   status.currencyBalance,
-													   cfg.buy_mult, status.enable_alerts);
-						//calculate sell order
-					Order sellorder = calculateOrder(lastTradePrice,
-													   status.curStep*cfg.sell_step_mult, dynmult.getSellMult(),
-													   status.ticker.ask, status.assetBalance,
-													   status.currencyBalance,
-													   cfg.sell_mult, status.enable_alerts);
-
+					Order buyorder, sellorder;
+					{
+						PhaseProfiler::Scope _(PhaseProfiler::calculateOrder);
+							//calculate buy order
+						buyorder = calculateOrder(lastTradePrice,
+														  -status.curStep*cfg.buy_step_mult, dynmult.getBuyMult(),
+														   status.ticker.bid, status.assetBalance,
+														   status.currencyBalance,
+														   cfg.buy_mult, status.enable_alerts);
+							//calculate sell order
+						sellorder = calculateOrder(lastTradePrice,
+														   status.curStep*cfg.sell_step_mult, dynmult.getSellMult(),
+														   status.ticker.ask, status.assetBalance,
+														   status.currencyBalance,
+														   cfg.sell_mult, status.enable_alerts);
+					}
 
 
 
-					try {
-						setOrder(orders.buy, buyorder, buy_alert);
-						if (!orders.buy.has_value()) {
+					{
+						PhaseProfiler::Scope _(PhaseProfiler::setOrder);
+						try {
+							setOrder(orders.buy, buyorder, buy_alert);
+							if (!orders.buy.has_value()) {
+								acceptLoss(status, 1);
+							}
+						} catch (std::exception &e) {
+							buy_order_error = e.what();
 							acceptLoss(status, 1);
 						}
-					} catch (std::exception &e) {
-						buy_order_error = e.what();
-						acceptLoss(status, 1);
-					}
-					try {
-						setOrder(orders.sell, sellorder, sell_alert);
-						if (!orders.sell.has_value()) {
-							acceptLoss(status, -1);
+						try {
+							setOrder(orders.sell, sellorder, sell_alert);
+							if (!orders.sell.has_value()) {
+								acceptLoss(status, -1);
+							}
+						} catch (std::exception &e) {
+							sell_order_error = e.what();
+							acceptLoss(status,-1);
 						}
-					} catch (std::exception &e) {
-						sell_order_error = e.what();
-						acceptLoss(status,-1);
 					}
 
 					if (!recalc && !manually) {
-						update_dynmult(false,false);
+						for (unsigned int i = 0; i < minutes; i++) update_dynmult(false,false);
 					}
 
 					//report order errors to UI
@@ -297,6 +322,7 @@ void MTrader::perform(bool manually) {
 		}
 
 		if (!cfg.hidden) {
+			PhaseProfiler::Scope _(PhaseProfiler::reporting);
 			int last_trade_dir = !anytrades?0:sgn(status.new_trades.trades.back().size);
 			if (fast_trade) {
 				if (last_trade_dir < 0) orders.sell.reset();
@@ -326,7 +352,13 @@ void MTrader::perform(bool manually) {
 		}
 
 		if (!manually) {
-			if (chart.empty() || chart.back().time < status.chartItem.time) {
+			if (minutes) {
+				//cycle was longer than a minute, fill missing minutes by current price
+				for (unsigned int i = minutes; i > 1; i--) {
+					ChartItem itm = status.chartItem;
+					itm.time -= (i-1)*60000;
+					chart.push_back(itm);
+				}
 				//store current price (to build chart)
 				chart.push_back(status.chartItem);
 				{
@@ -345,7 +377,10 @@ void MTrader::perform(bool manually) {
 
 
 		//save state
-		saveState();
+		{
+			PhaseProfiler::Scope _(PhaseProfiler::saveState);
+			saveState();
+		}
 
 	} catch (std::exception &e) {
 		statsvc->reportError(IStatSvc::ErrorObj(e.what()));
@@ -859,6 +894,39 @@ bool MTrader::processTrades(Status &st) {
 	return true;
 }
 
+unsigned int MTrader::chartMinutes(std::uint64_t time) const {
+	if (chart.empty()) return 1;
+	std::uint64_t last = chart.back().time/60000;
+	std::uint64_t cur = time/60000;
+	if (cur <= last) return 0;
+	//longer gap means that trading was stopped, it is not filled
+	if (cur - last > maxChartFill) return 1;
+	return static_cast<unsigned int>(cur - last);
+}
+
+void MTrader::updateCycleStats(const Status &st) {
+	if (cycleStats.time && st.chartItem.time > cycleStats.time && cycleStats.price > 0 && st.curPrice > 0) {
+		double move = std::abs(std::log(st.curPrice/cycleStats.price));
+		double v = move * 1000.0 / (st.chartItem.time - cycleStats.time);
+		//react to raising volatility immediately, calm down slowly
+		cycleStats.velocity = v > cycleStats.velocity?v:cycleStats.velocity * 0.8 + v * 0.2;
+	}
+	cycleStats.price = st.curPrice;
+	cycleStats.time = st.chartItem.time;
+	cycleStats.step = st.curStep;
+}
+
+unsigned int MTrader::getCycleInterval(unsigned int minInterval, unsigned int maxInterval) const {
+	//not initialized yet
+	if (cycleStats.step <= 0 || !std::isfinite(cycleStats.step)) return minInterval;
+	if (cycleStats.velocity <= 0) return maxInterval;
+	//time needed to move price by quarter of distance of orders
+	double t = cycleStats.step / cycleStats.velocity / 4;
+	if (!std::isfinite(t) || t > maxInterval) return maxInterval;
+	if (t < minInterval) return minInterval;
+	return static_cast<unsigned int>(t);
+}
+
 void MTrader::update_dynmult(bool buy_trade,bool sell_trade) {
 	dynmult.update(buy_trade, sell_trade);
 }
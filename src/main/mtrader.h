@@ -13,8 +13,10 @@
 
 #include <shared/ini_config.h>
 #include <imtjson/namedEnum.h>
+#include "fillmodel.h"
 #include "idailyperfmod.h"
 #include "istatsvc.h"
+#include "profiler.h"
 #include "storage.h"
 #include "report.h"
 #include "strategy.h"
@@ -71,6 +73,7 @@ struct MTrader_Config {
 	bool dynmult_mult;
 
 	Strategy strategy = Strategy(nullptr);
+	FillModel_Config fill_model;
 
 	void loadConfig(json::Value data, bool force_dry_run);
 
@@ -201,6 +204,12 @@ public:
 	std::optional<double> getInternalBalance() const;
 	std::optional<double> getInternalCurrencyBalance() const;
 
+	const PhaseProfiler &getProfiler() const {return profiler;}
+
+	///Recommended delay to the next cycle in seconds
+	/** It is derived from recent movement of the price and distance of the orders */
+	unsigned int getCycleInterval(unsigned int minInterval, unsigned int maxInterval) const;
+
 
 
 protected:
@@ -253,6 +262,19 @@ protected:
 	size_t magic = 0;
 	size_t uid = 0;
 	PerformanceReport tempPr;
+	PhaseProfiler profiler;
+
+	struct CycleStats {
+		double price = 0;
+		std::uint64_t time = 0;
+		///average movement of the price (log) per second
+		double velocity = 0;
+		double step = 0;
+	};
+	CycleStats cycleStats;
+
+	///max count of minutes filled in the chart when cycle was delayed
+	static constexpr unsigned int maxChartFill = 5;
 
 	void loadState();
 	void saveState();
@@ -264,6 +286,8 @@ protected:
 	bool processTrades(Status &st);
 
 	void update_dynmult(bool buy_trade,bool sell_trade);
+	unsigned int chartMinutes(std::uint64_t time) const;
+	void updateCycleStats(const Status &st);
 	static void alertTrigger(Status &st, double price);
 
 	void acceptLoss(const Status &st, double dir);
@@ -0,0 +1,97 @@
+/*
+ * profiler.cpp
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#include "profiler.h"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include <imtjson/array.h>
+#include <imtjson/object.h>
+
+thread_local PhaseProfiler::Cycle *PhaseProfiler::current = nullptr;
+
+const char *PhaseProfiler::phaseNames[phaseCount] = {
+		"getOrders",
+		"getMarketStatus",
+		"processTrades",
+		"strategy",
+		"calculateOrder",
+		"setOrder",
+		"reporting",
+		"saveState",
+		"total"
+};
+
+static std::uint64_t elapsedUs(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+PhaseProfiler::Cycle::Cycle(PhaseProfiler &owner)
+	:owner(owner),prev(current),start(std::chrono::steady_clock::now()) {
+	current = this;
+}
+
+PhaseProfiler::Cycle::~Cycle() {
+	current = prev;
+	accum[total] = elapsedUs(start);
+	used[total] = true;
+	owner.commit(*this);
+}
+
+PhaseProfiler::Scope::Scope(Phase phase)
+	:cycle(current),phase(phase) {
+	if (cycle) start = std::chrono::steady_clock::now();
+}
+
+PhaseProfiler::Scope::~Scope() {
+	if (cycle) {
+		cycle->accum[phase] += elapsedUs(start);
+		cycle->used[phase] = true;
+	}
+}
+
+void PhaseProfiler::commit(const Cycle &cycle) {
+	std::lock_guard _(lock);
+	for (unsigned int i = 0; i < phaseCount; i++) {
+		if (cycle.used[i]) {
+			History &h = history[i];
+			h.samples[h.pos] = static_cast<std::uint32_t>(std::min<std::uint64_t>(cycle.accum[i], std::numeric_limits<std::uint32_t>::max()));
+			h.pos = (h.pos + 1) % historySize;
+			h.count++;
+		}
+	}
+}
+
+void PhaseProfiler::clear() {
+	std::lock_guard _(lock);
+	for (auto &&h: history) {
+		h.pos = 0;
+		h.count = 0;
+	}
+}
+
+json::Value PhaseProfiler::toJSON() const {
+	json::Array res;
+	std::vector<std::uint32_t> smp;
+	std::lock_guard _(lock);
+	for (unsigned int i = 0; i < phaseCount; i++) {
+		const History &h = history[i];
+		if (h.count == 0) continue;
+		smp.assign(h.samples.begin(), h.samples.begin() + std::min<std::uint64_t>(h.count, historySize));
+		std::sort(smp.begin(), smp.end());
+		auto pct = [&](double p) {
+			return smp[static_cast<std::size_t>(p * (smp.size()-1))]/1000.0;
+		};
+		res.push_back(json::Object
+				("phase", phaseNames[i])
+				("p50", pct(0.5))
+				("p99", pct(0.99))
+				("max", smp.back()/1000.0)
+				("count", h.count));
+	}
+	return res;
+}
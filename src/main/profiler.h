@@ -0,0 +1,99 @@
+/*
+ * profiler.h
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#ifndef SRC_MAIN_PROFILER_H_
+#define SRC_MAIN_PROFILER_H_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <imtjson/value.h>
+
+///Measures duration of phases of the trader's cycle
+/**
+ * Timers (Scope) write to a buffer which belongs to the current thread, so
+ * measurement itself doesn't need any locking. The buffer is committed to the profiler
+ * once per cycle (when the Cycle object is destroyed). The profiler keeps last
+ * samples of each phase to calculate percentiles
+ */
+class PhaseProfiler {
+public:
+
+	enum Phase {
+		getOrders,
+		getMarketStatus,
+		processTrades,
+		strategy,
+		calculateOrder,
+		setOrder,
+		reporting,
+		saveState,
+		///whole cycle
+		total,
+		phaseCount
+	};
+
+	static const char *phaseNames[phaseCount];
+
+	///count of samples kept for each phase
+	static constexpr unsigned int historySize = 256;
+
+	///Collects measurements of one cycle
+	class Cycle {
+	public:
+		Cycle(PhaseProfiler &owner);
+		~Cycle();
+		Cycle(const Cycle &) = delete;
+		Cycle &operator=(const Cycle &) = delete;
+	protected:
+		friend class Scope;
+		PhaseProfiler &owner;
+		Cycle *prev;
+		std::chrono::steady_clock::time_point start;
+		///accumulated time in microseconds, a phase can be measured multiple times
+		std::array<std::uint64_t, phaseCount> accum{};
+		std::array<bool, phaseCount> used{};
+	};
+
+	///Measures single phase. It is ignored when there is no active cycle on the thread
+	class Scope {
+	public:
+		Scope(Phase phase);
+		~Scope();
+		Scope(const Scope &) = delete;
+		Scope &operator=(const Scope &) = delete;
+	protected:
+		Cycle *cycle;
+		Phase phase;
+		std::chrono::steady_clock::time_point start;
+	};
+
+	///Returns statistics of each phase in milliseconds (p50, p99, max, count)
+	json::Value toJSON() const;
+	///Forget all samples
+	void clear();
+
+protected:
+
+	struct History {
+		std::array<std::uint32_t, historySize> samples;
+		unsigned int pos = 0;
+		///total count of samples (including forgotten ones)
+		std::uint64_t count = 0;
+	};
+
+	mutable std::mutex lock;
+	std::array<History, phaseCount> history;
+
+	void commit(const Cycle &cycle);
+
+	static thread_local Cycle *current;
+};
+
+
+
+#endif /* SRC_MAIN_PROFILER_H_ */
@@ -0,0 +1,69 @@
+/*
+ * ratelimit.cpp
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#include "ratelimit.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+RequestRateLimiter::CommandInfo RequestRateLimiter::getCommandInfo(const std::string_view &command) {
+	//weights are modeled after typical REST weights of the exchanges
+	static const std::pair<std::string_view, CommandInfo> table[] = {
+			{"placeOrder", {high, 1}},
+			{"getOpenOrders", {normal, 3}},
+			{"syncTrades", {normal, 10}},
+			{"getTicker", {low, 1}},
+			{"getBalance", {low, 10}},
+			{"getFees", {low, 1}},
+			{"getInfo", {low, 1}},
+			{"getAllPairs", {low, 10}},
+	};
+	for (auto &&x: table) {
+		if (x.first == command) return x.second;
+	}
+	return {low, 0};
+}
+
+void RequestRateLimiter::setLimit(unsigned int weightPerMinute, unsigned int burstSeconds) {
+	std::lock_guard _(lock);
+	rate = weightPerMinute / 60000.0;
+	capacity = std::max(1.0, rate * burstSeconds * 1000.0);
+	tokens = capacity;
+	last = Clock::now();
+	cond.notify_all();
+}
+
+void RequestRateLimiter::refill(Clock::time_point now) {
+	double ms = std::chrono::duration<double, std::milli>(now - last).count();
+	tokens = std::min(capacity, tokens + ms * rate);
+	last = now;
+}
+
+void RequestRateLimiter::acquire(const std::string_view &command) {
+	CommandInfo nfo = getCommandInfo(command);
+	if (nfo.weight == 0) return;
+	std::unique_lock _(lock);
+	if (rate <= 0) return;
+	waiting[nfo.priority]++;
+	while (true) {
+		//limit could change during waiting
+		if (rate <= 0) break;
+		auto now = Clock::now();
+		refill(now);
+		double w = std::min<double>(nfo.weight, capacity);
+		bool blocked = std::any_of(waiting.begin(), waiting.begin()+nfo.priority, [](unsigned int x){return x>0;});
+		if (!blocked && tokens >= w) {
+			tokens -= w;
+			break;
+		}
+		//when blocked by higher priority, wait until it is served, but not longer than the time needed to refill
+		auto need = std::chrono::milliseconds(static_cast<long>(std::ceil(std::max(1.0, (w - tokens)/rate))));
+		cond.wait_for(_, need);
+	}
+	waiting[nfo.priority]--;
+	cond.notify_all();
+}
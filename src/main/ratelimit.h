@@ -0,0 +1,75 @@
+/*
+ * ratelimit.h
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#ifndef SRC_MAIN_RATELIMIT_H_
+#define SRC_MAIN_RATELIMIT_H_
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+
+///Limits weight of requests sent to the exchange (token bucket)
+/**
+ * Every command has a weight and a priority. Request waits until the bucket has enough
+ * tokens and there is no waiting request of higher priority, so order placement
+ * is never delayed by tickers and balances. Commands which don't reach the exchange
+ * have zero weight and never wait.
+ *
+ * Limiter is disabled until a limit is set
+ */
+class RequestRateLimiter {
+public:
+
+	enum Priority {
+		///order placement
+		high,
+		///orders and trades
+		normal,
+		///tickers, balances, market info
+		low,
+		priorityCount
+	};
+
+	struct CommandInfo {
+		Priority priority;
+		unsigned int weight;
+	};
+
+	///Returns priority and weight of the command
+	static CommandInfo getCommandInfo(const std::string_view &command);
+
+	///Sets the limit
+	/**
+	 * @param weightPerMinute total weight allowed per minute, 0 disables limiter
+	 * @param burstSeconds size of the bucket in seconds of the limit. Smaller value
+	 * spreads bursts of the requests
+	 */
+	void setLimit(unsigned int weightPerMinute, unsigned int burstSeconds = 10);
+
+	///Waits for the tokens for the command
+	void acquire(const std::string_view &command);
+
+protected:
+	using Clock = std::chrono::steady_clock;
+
+	std::mutex lock;
+	std::condition_variable cond;
+	///tokens per millisecond
+	double rate = 0;
+	double capacity = 0;
+	double tokens = 0;
+	Clock::time_point last;
+	std::array<unsigned int, priorityCount> waiting = {};
+
+	void refill(Clock::time_point now);
+};
+
+
+
+#endif /* SRC_MAIN_RATELIMIT_H_ */
@@ -0,0 +1,119 @@
+/*
+ * telemetry.cpp
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#include "telemetry.h"
+
+#include <algorithm>
+#include <imtjson/object.h>
+
+std::size_t BrokerTelemetry::commandIndex(const std::string_view &command) {
+	auto iter = std::find(commands.begin(), commands.end()-1, command);
+	return iter - commands.begin();
+}
+
+void BrokerTelemetry::record(const std::string_view &command, const Sample &sample) {
+	CommandStats &st = stats[commandIndex(command)];
+	st.count.fetch_add(1, std::memory_order_relaxed);
+	if (sample.error) st.errors.fetch_add(1, std::memory_order_relaxed);
+	if (sample.timeout) st.timeouts.fetch_add(1, std::memory_order_relaxed);
+	st.latencySum.fetch_add(sample.latency, std::memory_order_relaxed);
+	st.bytesOut.fetch_add(sample.bytesOut, std::memory_order_relaxed);
+	st.bytesIn.fetch_add(sample.bytesIn, std::memory_order_relaxed);
+	std::uint64_t ms = sample.latency/1000;
+	auto bucket = std::lower_bound(latencyBounds.begin(), latencyBounds.end(), ms) - latencyBounds.begin();
+	st.hist[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void BrokerTelemetry::recordRestart() {
+	restarts.fetch_add(1, std::memory_order_relaxed);
+}
+
+json::Value BrokerTelemetry::toJSON() const {
+	json::Object cmds;
+	for (std::size_t i = 0; i < commands.size(); i++) {
+		const CommandStats &st = stats[i];
+		std::uint64_t count = st.count.load(std::memory_order_relaxed);
+		if (count == 0) continue;
+		json::Object hist;
+		for (std::size_t j = 0; j < latencyBounds.size(); j++) {
+			hist.set(std::to_string(latencyBounds[j]), st.hist[j].load(std::memory_order_relaxed));
+		}
+		hist.set("inf", st.hist[latencyBounds.size()].load(std::memory_order_relaxed));
+		cmds.set(json::StrViewA(commands[i].data(), commands[i].size()), json::Object
+				("count", count)
+				("errors", st.errors.load(std::memory_order_relaxed))
+				("timeouts", st.timeouts.load(std::memory_order_relaxed))
+				("avg_latency_ms", st.latencySum.load(std::memory_order_relaxed)/1000.0/count)
+				("bytes_out", st.bytesOut.load(std::memory_order_relaxed))
+				("bytes_in", st.bytesIn.load(std::memory_order_relaxed))
+				("latency_ms", hist));
+	}
+	return json::Object
+			("restarts", restarts.load(std::memory_order_relaxed))
+			("commands", cmds);
+}
+
+void BrokerTelemetry::toPrometheus(std::ostream &out, const NamedTelemetry &brokers) {
+
+	auto counter = [&](const char *name, const char *help, auto &&fn) {
+		out << "# HELP " << name << " " << help << "\n";
+		out << "# TYPE " << name << " counter\n";
+		for (auto &&b: brokers) {
+			for (std::size_t i = 0; i < commands.size(); i++) {
+				const CommandStats &st = b.second->stats[i];
+				if (st.count.load(std::memory_order_relaxed) == 0) continue;
+				out << name << "{broker=\"" << b.first << "\",command=\"" << commands[i] << "\"} " << fn(st) << "\n";
+			}
+		}
+	};
+
+	counter("mmbot_broker_requests_total", "Count of requests sent to the broker", [](const CommandStats &st) {
+		return st.count.load(std::memory_order_relaxed);
+	});
+	counter("mmbot_broker_errors_total", "Count of failed requests", [](const CommandStats &st) {
+		return st.errors.load(std::memory_order_relaxed);
+	});
+	counter("mmbot_broker_timeouts_total", "Count of requests failed on timeout", [](const CommandStats &st) {
+		return st.timeouts.load(std::memory_order_relaxed);
+	});
+	counter("mmbot_broker_sent_bytes_total", "Bytes sent to the broker", [](const CommandStats &st) {
+		return st.bytesOut.load(std::memory_order_relaxed);
+	});
+	counter("mmbot_broker_received_bytes_total", "Bytes received from the broker", [](const CommandStats &st) {
+		return st.bytesIn.load(std::memory_order_relaxed);
+	});
+
+	const char *hname = "mmbot_broker_request_duration_seconds";
+	out << "# HELP " << hname << " Latency of requests\n";
+	out << "# TYPE " << hname << " histogram\n";
+	for (auto &&b: brokers) {
+		for (std::size_t i = 0; i < commands.size(); i++) {
+			const CommandStats &st = b.second->stats[i];
+			std::uint64_t count = st.count.load(std::memory_order_relaxed);
+			if (count == 0) continue;
+			std::uint64_t cumul = 0;
+			for (std::size_t j = 0; j < latencyBounds.size(); j++) {
+				cumul += st.hist[j].load(std::memory_order_relaxed);
+				out << hname << "_bucket{broker=\"" << b.first << "\",command=\"" << commands[i]
+					<< "\",le=\"" << latencyBounds[j]/1000.0 << "\"} " << cumul << "\n";
+			}
+			cumul += st.hist[latencyBounds.size()].load(std::memory_order_relaxed);
+			out << hname << "_bucket{broker=\"" << b.first << "\",command=\"" << commands[i]
+				<< "\",le=\"+Inf\"} " << cumul << "\n";
+			out << hname << "_sum{broker=\"" << b.first << "\",command=\"" << commands[i] << "\"} "
+				<< st.latencySum.load(std::memory_order_relaxed)/1000000.0 << "\n";
+			out << hname << "_count{broker=\"" << b.first << "\",command=\"" << commands[i] << "\"} "
+				<< cumul << "\n";
+		}
+	}
+
+	const char *rname = "mmbot_broker_restarts_total";
+	out << "# HELP " << rname << " Count of restarts of the broker process\n";
+	out << "# TYPE " << rname << " counter\n";
+	for (auto &&b: brokers) {
+		out << rname << "{broker=\"" << b.first << "\"} " << b.second->restarts.load(std::memory_order_relaxed) << "\n";
+	}
+}
@@ -0,0 +1,74 @@
+/*
+ * telemetry.h
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#ifndef SRC_MAIN_TELEMETRY_H_
+#define SRC_MAIN_TELEMETRY_H_
+
+#include <array>
+#include <atomic>
+#include <ostream>
+#include <string_view>
+#include <vector>
+#include <imtjson/value.h>
+
+///Statistics of commands sent to the broker
+/**
+ * Recording is lock-free, each command has own set of atomic counters.
+ * Commands are identified by name, unknown commands are counted as "other"
+ */
+class BrokerTelemetry {
+public:
+
+	///Upper bounds of latency buckets in milliseconds, last bucket is unbounded
+	static constexpr std::array<unsigned int, 12> latencyBounds = {1,5,10,25,50,100,250,500,1000,2500,5000,10000};
+
+	static constexpr std::array<std::string_view, 18> commands = {
+			"getBalance","syncTrades","getOpenOrders","getTicker","placeOrder",
+			"reset","getInfo","getFees","getAllPairs","getBrokerInfo",
+			"setApiKey","getApiKeyFields","getSettings","setSettings",
+			"restoreSettings","fetchPage","subaccount","other"
+	};
+
+	struct Sample {
+		///latency in microseconds
+		std::uint64_t latency;
+		bool error;
+		bool timeout;
+		std::uint64_t bytesOut;
+		std::uint64_t bytesIn;
+	};
+
+	void record(const std::string_view &command, const Sample &sample);
+	void recordRestart();
+
+	json::Value toJSON() const;
+
+	using NamedTelemetry = std::vector<std::pair<std::string, const BrokerTelemetry *> >;
+
+	///Writes telemetry of all brokers in Prometheus text format
+	static void toPrometheus(std::ostream &out, const NamedTelemetry &brokers);
+
+protected:
+
+	struct CommandStats {
+		std::atomic<std::uint64_t> count{0};
+		std::atomic<std::uint64_t> errors{0};
+		std::atomic<std::uint64_t> timeouts{0};
+		///sum of latencies in microseconds
+		std::atomic<std::uint64_t> latencySum{0};
+		std::atomic<std::uint64_t> bytesOut{0};
+		std::atomic<std::uint64_t> bytesIn{0};
+		std::array<std::atomic<std::uint64_t>, latencyBounds.size()+1> hist{};
+	};
+
+	std::array<CommandStats, commands.size()> stats;
+	std::atomic<std::uint64_t> restarts{0};
+
+	static std::size_t commandIndex(const std::string_view &command);
+
+};
+
+#endif /* SRC_MAIN_TELEMETRY_H_ */
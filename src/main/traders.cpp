@@ -10,12 +10,19 @@
 
 #include "traders.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 #include "../shared/countdown.h"
 #include "../shared/logOutput.h"
 #include "ext_stockapi.h"
 
 using ondra_shared::Countdown;
 using ondra_shared::logError;
+using ondra_shared::logDebug;
+using ondra_shared::logNote;
 NamedMTrader::NamedMTrader(IStockSelector &sel, StoragePtr &&storage, PStatSvc statsvc, Config cfg, std::string &&name)
 		:MTrader(sel, std::move(storage), std::move(statsvc), cfg), ident(std::move(name)) {
 }
@@ -48,6 +55,23 @@ void StockSelector::loadBrokers(const ondra_shared::IniConfig::Section &ini, boo
 	stock_markets.swap(map);
 }
 
+void StockSelector::setRateLimits(const ondra_shared::IniConfig::Section &ini) {
+	for (auto &&def: ini) {
+		ondra_shared::StrViewA name = def.first;
+		auto iter = stock_markets.find(std::string_view(name.data, name.length));
+		if (iter == stock_markets.end()) continue;
+		ExtStockApi *ex = dynamic_cast<ExtStockApi *>(iter->second.get());
+		if (ex) ex->setRateLimit(def.second.getUInt(0));
+	}
+}
+
+void StockSelector::setStandby(bool enable) {
+	for (auto &&x: stock_markets) {
+		ExtStockApi *ex = dynamic_cast<ExtStockApi *>(x.second.get());
+		if (ex && !ex->isSubaccount()) ex->setStandby(enable);
+	}
+}
+
 bool StockSelector::checkBrokerSubaccount(const std::string &name) {
 	auto f = stock_markets.find(name);
 	if (f == stock_markets.end()) {
@@ -106,6 +130,8 @@ test(test)
 
 void Traders::clear() {
 	traders.clear();
+	schedule.clear();
+	lastReset.clear();
 	stockSelector.clear();
 }
 
@@ -128,6 +154,8 @@ void Traders::addTrader(const MTrader::Config &mcfg ,ondra_shared::StrViewA n) {
 				std::make_unique<StatsSvc>(n, rpt, perfMod), mcfg, n);
 			auto lt = t.lock();
 			loadIcon(*lt);
+			std::string_view broker = mcfg.broker;
+			schedule[lt->ident] = CycleState{Clock::now(), false, std::string(broker.substr(0, broker.find('~'))), mcfg.pairsymb, false};
 			traders.insert(std::pair(StrViewA(lt->ident), std::move(t)));
 		} else {
 			throw std::runtime_error("Unable to load broker");
@@ -154,6 +182,8 @@ void Traders::removeTrader(ondra_shared::StrViewA n, bool including_state) {
 			//now we can erase
 		}
 		traders.erase(n);
+		auto iter = schedule.find(std::string_view(n.data, n.length));
+		if (iter != schedule.end()) schedule.erase(iter);
 	}
 }
 
@@ -168,11 +198,115 @@ static void resetBroker(IStockApi &api) {
 }
 
 void Traders::resetBrokers() {
+	ExtStockApi::beginResetRound();
 	stockSelector.forEachStock([](json::StrViewA, IStockApi&api) {
 		resetBroker(api);
 	});
 }
 
+void Traders::housekeepingBrokers() {
+	stockSelector.forEachStock([](json::StrViewA, IStockApi&api) {
+		AbstractExtern *extr = dynamic_cast<AbstractExtern *>(&api);
+		if (extr) extr->housekeeping(5);
+	});
+}
+
+bool Traders::consumeBudget(const std::string &broker, Clock::time_point now) {
+	if (cycleCfg.brokerBudget == 0) return true;
+	double cap = cycleCfg.brokerBudget;
+	auto iter = budgets.find(broker);
+	if (iter == budgets.end()) {
+		iter = budgets.emplace(broker, Budget{cap, now}).first;
+	}
+	Budget &b = iter->second;
+	double secs = std::chrono::duration<double>(now - b.last).count();
+	b.tokens = std::min(cap, b.tokens + secs * cap / 60.0);
+	b.last = now;
+	if (b.tokens < 1.0) return false;
+	b.tokens -= 1.0;
+	return true;
+}
+
+Traders::DueList Traders::getDueTraders(std::vector<IStockApi *> &brokers) {
+	auto now = Clock::now();
+	std::vector<std::pair<Clock::time_point, TMap::const_iterator> > due;
+	for (auto iter = traders.begin(); iter != traders.end(); ++iter) {
+		auto s = schedule.find(std::string_view(iter->first.data, iter->first.length));
+		if (s != schedule.end() && !s->second.running && s->second.nextRun <= now) {
+			due.emplace_back(s->second.nextRun, iter);
+		}
+	}
+	//most delayed traders first, they have priority when budget is exhausted
+	std::sort(due.begin(), due.end(), [](const auto &a, const auto &b) {
+		return a.first < b.first;
+	});
+	DueList res;
+	auto resetInterval = std::chrono::seconds(cycleCfg.resetInterval);
+	for (auto &&x: due) {
+		CycleState &st = schedule.find(std::string_view(x.second->first.data, x.second->first.length))->second;
+		//when budget is exhausted, trader stays due and runs on next tick
+		if (!consumeBudget(st.broker, now)) continue;
+		st.running = true;
+		res.emplace_back(x.second->first, x.second->second);
+		IStockApi *api = &x.second->second.lock_shared()->getBroker();
+		auto r = lastReset.find(api);
+		if (r == lastReset.end()) {
+			lastReset.emplace(api, now);
+			brokers.push_back(api);
+		} else if (r->second + resetInterval <= now) {
+			r->second = now;
+			brokers.push_back(api);
+		}
+	}
+	return res;
+}
+
+void Traders::resetBrokers(const std::vector<IStockApi *> &brokers) {
+	if (brokers.empty()) return;
+	ExtStockApi::beginResetRound();
+	for (IStockApi *api: brokers) {
+		try {
+			api->reset();
+		} catch (std::exception &e) {
+			logError("Exception when RESET: $1", e.what());
+		}
+	}
+}
+
+
+void Traders::finishCycle(const std::string &ident, unsigned int interval) {
+	auto iter = schedule.find(ident);
+	if (iter == schedule.end()) return;
+	interval = std::max(cycleCfg.minInterval, std::min(cycleCfg.maxInterval, interval));
+	iter->second.running = false;
+	if (iter->second.wakeup) {
+		iter->second.wakeup = false;
+		iter->second.nextRun = Clock::now();
+	} else {
+		iter->second.nextRun = Clock::now() + std::chrono::seconds(interval);
+	}
+}
+
+void Traders::processBrokerEvents() {
+	auto now = Clock::now();
+	stockSelector.forEachStock([&](json::StrViewA name, IStockApi &api) {
+		ExtStockApi *ex = dynamic_cast<ExtStockApi *>(&api);
+		if (ex == nullptr || ex->isSubaccount()) return;
+		for (json::Value ev: ex->collectEvents()) {
+			json::Value pair = ev["pair"];
+			logDebug("Broker event: $1 - $2", name, ev.toString());
+			for (auto &&x: schedule) {
+				CycleState &st = x.second;
+				if (st.broker == std::string_view(name.data, name.length)
+						&& (!pair.defined() || pair.getString() == json::StrViewA(st.pair))) {
+					if (st.running) st.wakeup = true;
+					else if (st.nextRun > now) st.nextRun = now;
+				}
+			}
+		}
+	});
+}
+
 /*void Traders::runTraders(bool manually) {
 
 	if (worker.defined()) {
@@ -232,3 +366,36 @@ void StockSelector::eraseSubaccounts() {
 		if (sb && sb->isSubaccount()) iter = stock_markets.erase(iter); else ++iter;
 	}
 }
+
+void Traders::preloadStates(const TMap &traders, unsigned int threads) {
+	using namespace ondra_shared;
+	using ms = std::chrono::milliseconds;
+
+	std::vector<SharedObject<NamedMTrader> > lst;
+	for (auto &&t: traders) lst.push_back(t.second);
+	std::atomic<std::size_t> next(0);
+	auto start = Clock::now();
+
+	auto worker = [&] {
+		for (std::size_t i = next++; i < lst.size(); i = next++) {
+			auto t = lst[i].lock();
+			LogObject lg(t->ident);
+			LogObject::Swap swap(lg);
+			auto tstart = Clock::now();
+			try {
+				t->init();
+				logProgress("State loaded in $1 ms", std::chrono::duration_cast<ms>(Clock::now() - tstart).count());
+			} catch (std::exception &e) {
+				//trader tries again in the first cycle
+				logError("Failed to load state: $1", e.what());
+			}
+		}
+	};
+
+	threads = std::max(1U, std::min<unsigned int>(threads, lst.size()));
+	std::vector<std::thread> thrs;
+	for (unsigned int i = 1; i < threads; i++) thrs.emplace_back(worker);
+	worker();
+	for (auto &&t: thrs) t.join();
+	logNote("Loaded states of $1 trader(s) in $2 ms", lst.size(), std::chrono::duration_cast<ms>(Clock::now() - start).count());
+}
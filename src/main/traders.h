@@ -7,6 +7,8 @@
 
 #ifndef SRC_MAIN_TRADERS_H_
 #define SRC_MAIN_TRADERS_H_
+#include <chrono>
+#include <map>
 #include "../shared/scheduler.h"
 #include "../shared/shared_object.h"
 #include "../shared/worker.h"
@@ -35,6 +37,10 @@ public:
 	StockMarketMap stock_markets;
 
 	void loadBrokers(const ondra_shared::IniConfig::Section &ini, bool test, int brk_timeout);
+	///Sets rate limits of brokers (weight per minute)
+	void setRateLimits(const ondra_shared::IniConfig::Section &ini);
+	///Enables standby processes of brokers
+	void setStandby(bool enable);
 	bool checkBrokerSubaccount(const std::string &name);
 	virtual IStockApi *getStock(const std::string_view &stockName) const override;
 //	void addStockMarket(ondra_shared::StrViewA name, PStockApi &&market);
@@ -84,10 +90,77 @@ public:
 	}
 
 	void resetBrokers();
+	///Stops idle brokers, should be called once per minute
+	void housekeepingBrokers();
 	SharedObject<NamedMTrader> find(json::StrViewA id) const;
 
+	///Configuration of the cycle scheduler
+	struct CycleConfig {
+		///minimal delay between cycles of a trader in seconds
+		unsigned int minInterval = 60;
+		///maximal delay between cycles of a trader in seconds
+		/** Default values keep fixed one minute cycle, adaptive cycle must be enabled in the config */
+		unsigned int maxInterval = 60;
+		///max count of cycles per minute for single broker (0 - unlimited)
+		unsigned int brokerBudget = 0;
+		///minimal delay between resets of single broker in seconds (lifetime of cached data)
+		unsigned int resetInterval = 10;
+	};
+
+	CycleConfig cycleCfg;
+
+	using DueList = std::vector<std::pair<std::string, SharedObject<NamedMTrader> > >;
+
+	///Returns traders, which should run now
+	/** Returned traders are marked as running until finishCycle() is called.
+	 *
+	 * @param brokers receives brokers of these traders, which were not reset during
+	 * resetInterval. Reset them by resetBrokers() outside of the lock before the
+	 * traders run, so the traders receive fresh data
+	 */
+	DueList getDueTraders(std::vector<IStockApi *> &brokers);
+	///Resets listed brokers, doesn't need lock
+	static void resetBrokers(const std::vector<IStockApi *> &brokers);
+	///Schedules next cycle of the trader
+	void finishCycle(const std::string &ident, unsigned int interval);
+	///Reads events from brokers. Traders affected by an event are scheduled to run immediately
+	void processBrokerEvents();
+
+	///Loads states of the traders concurrently
+	/**
+	 * Traders are initialized (market info and state) before the first cycle, so
+	 * the first cycle is not delayed by parsing the states.
+	 *
+	 * @param traders copy of the traders map, Traders doesn't need to be locked
+	 * @param threads count of threads
+	 */
+	static void preloadStates(const TMap &traders, unsigned int threads);
+
 private:
 	void loadIcon(MTrader &t);
+
+	using Clock = std::chrono::steady_clock;
+
+	struct CycleState {
+		Clock::time_point nextRun;
+		bool running;
+		///name of the broker (without subaccount)
+		std::string broker;
+		std::string pair;
+		///event arrived while running, run again
+		bool wakeup;
+	};
+
+	struct Budget {
+		double tokens;
+		Clock::time_point last;
+	};
+
+	std::map<std::string, CycleState, std::less<> > schedule;
+	std::map<std::string, Budget, std::less<> > budgets;
+	std::map<IStockApi *, Clock::time_point> lastReset;
+
+	bool consumeBudget(const std::string &broker, Clock::time_point now);
 };
 
 
@@ -9,6 +9,7 @@
 #include "webcfg.h"
 
 #include <random>
+#include <sstream>
 #include <imtjson/array.h>
 #include <imtjson/object.h>
 #include <imtjson/string.h>
@@ -45,7 +46,8 @@ NamedEnum<WebCfg::Command> WebCfg::strCommand({
 	{WebCfg::spread, "spread"},
 	{WebCfg::strategy, "strategy"},
 	{WebCfg::upload_prices, "upload_prices"},
-	{WebCfg::upload_trades, "upload_trades"}
+	{WebCfg::upload_trades, "upload_trades"},
+	{WebCfg::telemetry, "telemetry"}
 });
 
 WebCfg::WebCfg( const SharedObject<State> &state,
@@ -95,6 +97,7 @@ bool WebCfg::operator ()(const simpleServer::HTTPRequest &req,
 		case strategy: return reqStrategy(req);
 		case upload_prices: return reqUploadPrices(req);
 		case upload_trades: return reqUploadTrades(req);
+		case telemetry: return reqTelemetry(req, rest);
 		}
 	}
 	return false;
@@ -560,7 +563,7 @@ bool WebCfg::reqTraders(simpleServer::HTTPRequest req, ondra_shared::StrViewA vp
 					req.sendResponse(std::move(hdr), "true");
 				} else {
 					req.sendResponse(std::move(hdr),
-						Value(Object("entries",{"stop","reset","repair","broker","trading","strategy"})).stringify());
+						Value(Object("entries",{"stop","reset","repair","broker","trading","strategy","profile"})).stringify());
 				}
 			} else {
 				auto trl = tr.lock();
@@ -604,6 +607,7 @@ bool WebCfg::reqTraders(simpleServer::HTTPRequest req, ondra_shared::StrViewA vp
 					out.set("ticker", Object("ask", ticker.ask)("bid", ticker.bid)("last", ticker.last)("time", ticker.time));
 					out.set("orders", getOpenOrders(broker, trl->getConfig().pairsymb));
 					out.set("broker", trl->getConfig().broker);
+					out.set("profile", trl->getProfiler().toJSON());
 					std::optional<double> ibalance ;
 					if (trl != nullptr) {
 						ibalance = trl->getInternalBalance();
@@ -626,6 +630,9 @@ bool WebCfg::reqTraders(simpleServer::HTTPRequest req, ondra_shared::StrViewA vp
 						out.set("strategy",Object("size", (minfo.invert_price?-1:1)*order.size));
 					}
 					req.sendResponse(std::move(hdr), Value(out).stringify());
+				} else if (cmd == "profile") {
+					if (!req.allowMethods({"GET"})) return true;
+					req.sendResponse(std::move(hdr), trl->getProfiler().toJSON().stringify());
 				} else if (cmd == "strategy") {
 					if (!req.allowMethods({"GET","PUT"})) return true;
 					Strategy strategy = trl->getStrategy();
@@ -1292,3 +1299,26 @@ bool WebCfg::reqStrategy(simpleServer::HTTPRequest req) {
 	req.sendResponse("application/json", out.toString());
 	return true;
 }
+
+bool WebCfg::reqTelemetry(simpleServer::HTTPRequest req, ondra_shared::StrViewA rest) {
+	if (!req.allowMethods({"GET"})) return true;
+	BrokerTelemetry::NamedTelemetry brokers;
+	auto trl = trlist.lock_shared();
+	trl->stockSelector.forEachStock([&](const std::string_view &name, IStockApi &api) {
+		const ExtStockApi *ex = dynamic_cast<const ExtStockApi *>(&api);
+		//subaccounts share telemetry with the main account
+		if (ex && !ex->isSubaccount()) brokers.emplace_back(std::string(name), &ex->getTelemetry());
+	});
+	if (rest.empty()) {
+		Object res;
+		for (auto &&b: brokers) res.set(b.first, b.second->toJSON());
+		req.sendResponse("application/json", Value(res).stringify());
+	} else if (rest == "metrics") {
+		std::ostringstream out;
+		BrokerTelemetry::toPrometheus(out, brokers);
+		req.sendResponse("text/plain; version=0.0.4", out.str());
+	} else {
+		req.sendErrorPage(404);
+	}
+	return true;
+}
@@ -125,6 +125,7 @@ public:
 		strategy,
 		upload_prices,
 		upload_trades,
+		telemetry,
 	};
 
 	AuthMapper auth;
@@ -150,6 +151,7 @@ protected:
 	bool reqUploadPrices(simpleServer::HTTPRequest req);
 	bool reqUploadTrades(simpleServer::HTTPRequest req);
 	bool reqStrategy(simpleServer::HTTPRequest req);
+	bool reqTelemetry(simpleServer::HTTPRequest req, ondra_shared::StrViewA rest);
 
 	using Sync = std::unique_lock<std::recursive_mutex>;
 
@@ -0,0 +1,116 @@
+/*
+ * delivery.cpp
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#include "delivery.h"
+
+#include <algorithm>
+#include <cctype>
+#include <imtjson/array.h>
+#include <imtjson/object.h>
+#include <imtjson/string.h>
+
+using json::Object;
+using json::Value;
+
+Value prepareItem(const Config &cfg, Value data) {
+	data = data.replace("ident",cfg.ident);
+	data = data.replace("_id", json::String({"trade.",cfg.ident,".",data["uid"].toString(),".",data["tradeId"].toString()}));
+	return data;
+}
+
+Value enrichItem(Value item, Value rates) {
+	Value rtable = rates["rates"];
+	double change = item["change"].getNumber();
+	if (!rtable.defined() || change == 0) return item;
+	std::string cur = item["currency"].toString().str();
+	std::transform(cur.begin(), cur.end(), cur.begin(), [](unsigned char c){return std::toupper(c);});
+	double rate = rtable[cur].getNumber();
+	if (rate == 0) return item;
+	double btc = change * rate;
+	item = item.replace("btc", btc);
+	Value fees = rates["fees"];
+	if (fees.defined()) {
+		Value f = fees["general"];
+		Value spec = fees["idents"][item["ident"].getString()];
+		if (spec.defined()) f = spec;
+		item = item.replace("fees", -btc * f.getNumber());
+	}
+	return item;
+}
+
+static bool isConflict(const HTTPJson::UnknownStatusException &e) {
+	return e.getStatusCode() == 409;
+}
+
+///Server refused the content of the request, repeated delivery would be refused too
+static bool isPermanent(const HTTPJson::UnknownStatusException &e) {
+	int code = e.getStatusCode();
+	return code == 400 || code == 403 || code == 413;
+}
+
+static Value getRates(HTTPJson &httpc, const Config &cfg) {
+	try {
+		return httpc.GET(cfg.ratesUrl, Object("Accept","application/json"));
+	} catch (const HTTPJson::UnknownStatusException &e) {
+		//no rates, items are stored without btc and fees (as the update function does)
+		if (e.getStatusCode() == 404) return json::undefined;
+		throw;
+	}
+}
+
+static void sendSingle(HTTPJson &httpc, const Config &cfg, const std::vector<Value> &items, std::vector<Spooler::Rejected> &rejected) {
+	for (Value v : items) {
+		try {
+			httpc.SEND(cfg.postUrl, cfg.postMethod, v, Object("Content-Type","application/json"));
+		} catch (const HTTPJson::UnknownStatusException &e) {
+			//item is already stored
+			if (isConflict(e)) continue;
+			if (!isPermanent(e)) throw;
+			rejected.push_back({v, e.what()});
+		}
+	}
+}
+
+static void sendBulk(HTTPJson &httpc, const Config &cfg, const std::vector<Value> &items, std::vector<Spooler::Rejected> &rejected) {
+	Value resp;
+	try {
+		resp = httpc.POST(cfg.bulkUrl, Object("docs", Value(json::array, items.begin(), items.end(), [](const Value &v){return v;})),
+				Object("Content-Type","application/json"));
+	} catch (const HTTPJson::UnknownStatusException &e) {
+		if (!isPermanent(e)) throw;
+		if (items.size() == 1) {
+			rejected.push_back({items[0], e.what()});
+		} else {
+			//whole batch was refused, send items one by one to find the rejected ones
+			for (const Value &v: items) sendBulk(httpc, cfg, {v}, rejected);
+		}
+		return;
+	}
+	for (Value r: resp) {
+		Value err = r["error"];
+		//conflict means, that item is already stored
+		if (err.defined() && err.getString() != "conflict") {
+			std::string reason = json::String({r["id"].toString(), ": ", err.toString(), " ", r["reason"].getString()}).str();
+			auto iter = std::find_if(items.begin(), items.end(), [&](const Value &v){return v["_id"] == r["id"];});
+			if (iter == items.end()) throw std::runtime_error("Unknown item rejected: " + reason);
+			rejected.push_back({*iter, reason});
+		}
+	}
+}
+
+std::vector<Spooler::Rejected> sendItems(HTTPJson &httpc, const Config &cfg, const std::vector<Value> &items) {
+	std::vector<Spooler::Rejected> rejected;
+	if (cfg.bulkUrl.empty()) {
+		sendSingle(httpc, cfg, items, rejected);
+	} else {
+		Value rates = getRates(httpc, cfg);
+		std::vector<Value> docs;
+		docs.reserve(items.size());
+		for (const Value &v: items) docs.push_back(enrichItem(v, rates));
+		sendBulk(httpc, cfg, docs, rejected);
+	}
+	return rejected;
+}
@@ -0,0 +1,49 @@
+/*
+ * delivery.h
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#ifndef SRC_REPORT_BROKER_DELIVERY_H_
+#define SRC_REPORT_BROKER_DELIVERY_H_
+
+#include <string>
+#include <vector>
+#include <imtjson/value.h>
+#include "../brokers/httpjson.h"
+#include "spooler.h"
+
+struct Config {
+	std::string postUrl;
+	std::string postMethod;
+	std::string bulkUrl;
+	std::string ratesUrl;
+	std::string getUrl;
+	std::string ident;
+	std::string tmpfile;
+	unsigned int batchSize;
+};
+
+///Creates item for the spool. Item has idempotent id, so duplicate delivery is detected by the server
+json::Value prepareItem(const Config &cfg, json::Value data);
+
+///Calculates fields btc and fees of the item
+/**
+ * It is the same calculation as the update function sendItem of the design document,
+ * it is used when items are sent through bulk_url, which bypasses the update function
+ *
+ * @param item item
+ * @param rates rates document (fields rates and fees)
+ * @return item with btc and fees, or unchanged item if there is no rate for its currency
+ */
+json::Value enrichItem(json::Value item, json::Value rates);
+
+///Sends items to the server
+/**
+ * @return items permanently rejected by the server. Throws exception when
+ * the delivery should be repeated
+ */
+std::vector<Spooler::Rejected> sendItems(HTTPJson &httpc, const Config &cfg, const std::vector<json::Value> &items);
+
+
+#endif /* SRC_REPORT_BROKER_DELIVERY_H_ */
@@ -7,32 +7,24 @@
 #include <iostream>
 
 #include <simpleServer/urlencode.h>
+#include <imtjson/array.h>
 #include <imtjson/value.h>
 #include <imtjson/object.h>
+#include <imtjson/string.h>
 #include "../shared/default_app.h"
 #include "../brokers/httpjson.h"
-#include "../shared/countdown.h"
 #include "../shared/msgqueue.h"
-#include "../shared/worker.h"
+#include "delivery.h"
+#include "spooler.h"
 
 using json::Object;
 using json::Value;
-using ondra_shared::Countdown;
 using ondra_shared::DefaultApp;
 using ondra_shared::IniConfig;
 using namespace simpleServer;
 
 
 
-struct Config {
-	std::string postUrl;
-	std::string postMethod;
-	std::string getUrl;
-	std::string ident;
-	std::string tmpfile;
-};
-
-
 std::string replaceIdent(std::string url, const std::string &ident) {
 	auto p = url.find("%ident%");
 	while (p != url.npos) {
@@ -49,9 +41,16 @@ Config loadConfig(const IniConfig::Section &sect) {
 	c.postMethod = sect.mandatory["post_method"].getString();
 	c.ident = sect.mandatory["ident"].getString();
 	c.tmpfile = sect.mandatory["work_file"].getPath();
+	c.bulkUrl = sect["bulk_url"].getString();
+	c.ratesUrl = sect["rates_url"].getString();
+	c.batchSize = sect["batch_size"].getUInt(100);
 
 	c.getUrl = replaceIdent(c.getUrl, c.ident);
 	c.postUrl = replaceIdent(c.postUrl, c.ident);
+	c.bulkUrl = replaceIdent(c.bulkUrl, c.ident);
+	//bulk_url bypasses the update function, which calculates btc and fees from the rates
+	if (!c.bulkUrl.empty() && c.ratesUrl.empty())
+		throw std::runtime_error("bulk_url requires rates_url");
 	return c;
 }
 
@@ -68,57 +67,8 @@ Value readFromStream(std::istream &in) {
 	return json::undefined;
 }
 
-static std::mutex lock;
-
-void storeToSend(const Config &cfg, Value data) {
-	std::unique_lock<std::mutex> _(lock);
-	data = data.replace("ident",cfg.ident);
-	std::ofstream f(cfg.tmpfile, std::ios::out|std::ios::app);
-	data.toStream(f);
-	f << std::endl;
-}
-
-std::vector<Value> readStorage(std::string fname) {
-	std::ifstream f(fname, std::ios::in);
-	std::vector<Value>  out;
-	if (!!f) {
-		Value v = readFromStream(f);
-		while (v.hasValue()) {
-			out.push_back(v);
-			v = readFromStream(f);
-		}
-	}
-	return out;
-}
-
 ondra_shared::MsgQueue<std::string> errors;
 
-void flushStoragePart(HTTPJson &httpc, const Config &cfg) {
-	std::string part = cfg.tmpfile+".part";
-
-	auto items = readStorage(part);
-	for (Value v : items) {
-		try {
-			httpc.SEND(cfg.postUrl, cfg.postMethod, v, Object("Content-Type","application/json"));
-		} catch (std::exception &e) {
-			errors.push(e.what());
-			storeToSend(cfg,v);
-		}
-	}
-	std::remove(part.c_str());
-}
-
-void flushStorage(HTTPJson &httpc, const Config &cfg) {
-
-	std::unique_lock<std::mutex> _(lock);
-	std::string part = cfg.tmpfile+".part";
-	std::rename(cfg.tmpfile.c_str(), part.c_str());
-	_.unlock();
-
-	flushStoragePart(httpc, cfg);
-
-}
-
 Value getReport(HTTPJson &httpc, const Config &cfg) {
 	return httpc.GET(cfg.getUrl, Object("Accept","application/json"));
 }
@@ -138,12 +88,16 @@ int main(int argc, char **argv) {
 		}
 
 		HTTPJson httpc(HttpClient("MMBot reporting client",newHttpsProvider(),newNoProxyProvider()),"");
+		HTTPJson sendc(HttpClient("MMBot reporting client",newHttpsProvider(),newNoProxyProvider()),"");
 
-		Worker wrk = Worker::create(1);
-
-		wrk >> [&]{
-			flushStoragePart(httpc,cfg);
-		};
+		Spooler spooler(cfg.tmpfile+".spool", cfg.batchSize, [&](const std::vector<Value> &items) {
+			return sendItems(sendc, cfg, items);
+		}, [](const std::string &msg) {
+			errors.push(msg);
+		});
+		//unsent items of the previous version
+		spooler.import(cfg.tmpfile+".part");
+		spooler.import(cfg.tmpfile);
 
 		Value req = readFromStream(std::cin);
 		Value resp;
@@ -155,19 +109,17 @@ int main(int argc, char **argv) {
 				auto cmd = req[0].getString();
 				if (cmd == "sendItem") {
 					Value data = req[1];
-					storeToSend(cfg, data);
+					spooler.push(prepareItem(cfg, data));
 					resp = Value(json::array,{true});
 				} else if (cmd == "getReport") {
 					Value rep = getReport(httpc,cfg);
 					resp = {true, rep};
 				} else if (cmd == "flush") {
+					spooler.flush();
 					resp = {true};
 				} else {
 					throw std::runtime_error("unsupported function");
 				}
-				wrk >> [&] {
-					flushStorage(httpc, cfg);
-				};
 			} catch (const std::exception &e) {
 				resp = {false, e.what()};
 			}
@@ -176,13 +128,7 @@ int main(int argc, char **argv) {
 			req = readFromStream(std::cin);
 		}
 
-		//wait for finish all tasks
-		{
-			Countdown ct(1);
-			wrk >> [&]{ct.dec();};
-			ct.wait();
-		}
-
+		//undelivered items stay in the spool
 	} catch (const std::exception &e) {
 		std::cerr << "Error: " << e.what() << std::endl;
 	}
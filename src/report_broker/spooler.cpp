@@ -0,0 +1,180 @@
+/*
+ * spooler.cpp
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#include "spooler.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <imtjson/string.h>
+
+Spooler::Spooler(const std::string &file, unsigned int batchSize, SendFn &&send, ErrorFn &&error)
+	:file(file),posFile(file+".pos"),rejectFile(file+".rejected"),batchSize(std::max(1U, batchSize)),send(std::move(send)),error(std::move(error))
+{
+	fd = ::open(file.c_str(), O_RDWR|O_CREAT|O_APPEND|O_CLOEXEC, 0666);
+	if (fd == -1) {
+		throw std::runtime_error("Unable to open: " + file + " - " + strerror(errno));
+	}
+	struct stat st;
+	if (fstat(fd, &st) == 0) size = st.st_size;
+	std::ifstream pf(posFile);
+	if (!!pf) pf >> pos;
+	if (pos > size) pos = 0;
+	thr = std::thread([this]{worker();});
+}
+
+Spooler::~Spooler() {
+	{
+		std::unique_lock _(lock);
+		stopped = true;
+		cond.notify_all();
+	}
+	thr.join();
+	::close(fd);
+}
+
+void Spooler::writeAll(const std::string &data) {
+	std::size_t p = 0;
+	while (p < data.size()) {
+		ssize_t r = ::write(fd, data.data()+p, data.size()-p);
+		if (r == -1) {
+			if (errno == EINTR) continue;
+			throw std::runtime_error("Unable to write: " + file + " - " + strerror(errno));
+		}
+		p += r;
+	}
+}
+
+void Spooler::push(const json::Value &item) {
+	json::String s = item.stringify();
+	std::string line(s.c_str(), s.length());
+	line.push_back('\n');
+	std::unique_lock _(lock);
+	writeAll(line);
+	size += line.size();
+	wake = true;
+	cond.notify_all();
+}
+
+void Spooler::flush() {
+	std::unique_lock _(lock);
+	wake = true;
+	cond.notify_all();
+}
+
+void Spooler::import(const std::string &fname) {
+	std::ifstream f(fname);
+	if (!f) return;
+	std::string line;
+	while (std::getline(f, line)) {
+		if (line.find_first_not_of(" \t\r") == line.npos) continue;
+		try {
+			push(json::Value::fromString(line));
+		} catch (std::exception &e) {
+			error(std::string("Spooler: skipped damaged item: ") + e.what());
+		}
+	}
+	f.close();
+	std::remove(fname.c_str());
+}
+
+std::size_t Spooler::readBatch(std::size_t from, std::vector<json::Value> &batch) {
+	char buff[65536];
+	std::string line;
+	while (batch.size() < batchSize) {
+		ssize_t r = ::pread(fd, buff, sizeof(buff), from + line.size());
+		if (r <= 0) break;
+		std::size_t consumed = 0;
+		for (ssize_t i = 0; i < r && batch.size() < batchSize; i++) {
+			if (buff[i] == '\n') {
+				line.append(buff+consumed, i-consumed);
+				consumed = i+1;
+				from += line.size()+1;
+				try {
+					if (line.find_first_not_of(" \t\r") != line.npos) {
+						batch.push_back(json::Value::fromString(line));
+					}
+				} catch (std::exception &e) {
+					error(std::string("Spooler: skipped damaged item: ") + e.what());
+				}
+				line.clear();
+			}
+		}
+		if (batch.size() >= batchSize) break;
+		//incomplete line is continued by next read
+		line.append(buff+consumed, r-consumed);
+		if (static_cast<std::size_t>(r) < sizeof(buff)) break;
+	}
+	return from;
+}
+
+void Spooler::commit(std::size_t newpos) {
+	std::unique_lock _(lock);
+	pos = newpos;
+	if (pos >= size) {
+		//everything delivered, start over
+		if (ftruncate(fd, 0) == 0) {
+			pos = size = 0;
+		}
+	}
+	std::string tmp = posFile + ".tmp";
+	{
+		std::ofstream pf(tmp, std::ios::out|std::ios::trunc);
+		pf << pos;
+	}
+	std::rename(tmp.c_str(), posFile.c_str());
+}
+
+void Spooler::reject(const std::vector<Rejected> &items) {
+	std::ofstream f(rejectFile, std::ios::out|std::ios::app);
+	for (const Rejected &r: items) {
+		f << r.item.stringify().c_str() << std::endl;
+		error("Spooler: item rejected, moved to " + rejectFile + ": " + r.reason);
+	}
+	if (!f) error("Spooler: unable to write: " + rejectFile);
+}
+
+void Spooler::worker() {
+	unsigned int backoff = 0;
+	std::unique_lock _(lock);
+	while (!stopped) {
+		if (pos >= size) {
+			cond.wait(_, [&]{return stopped || wake;});
+			wake = false;
+			continue;
+		}
+		std::size_t from = pos;
+		_.unlock();
+		std::vector<json::Value> batch;
+		std::size_t next = readBatch(from, batch);
+		bool ok = true;
+		if (!batch.empty()) try {
+			std::vector<Rejected> rejected = send(batch);
+			if (!rejected.empty()) reject(rejected);
+		} catch (std::exception &e) {
+			error(std::string("Spooler: delivery failed: ") + e.what());
+			ok = false;
+		}
+		if (ok && next > from) {
+			commit(next);
+			backoff = 0;
+			_.lock();
+		} else {
+			_.lock();
+			//failed or incomplete item at the end, wait and retry
+			backoff = std::min(maxBackoff, std::max(minBackoff, backoff * 2));
+			wake = false;
+			cond.wait_for(_, std::chrono::milliseconds(backoff), [&]{return stopped || wake;});
+			wake = false;
+		}
+	}
+}
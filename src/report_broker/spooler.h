@@ -0,0 +1,93 @@
+/*
+ * spooler.h
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#ifndef SRC_REPORT_BROKER_SPOOLER_H_
+#define SRC_REPORT_BROKER_SPOOLER_H_
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <imtjson/value.h>
+
+///Persistent queue of items, which are delivered in batches on the background
+/**
+ * Items are appended to the spool file (one JSON per line) through an open descriptor.
+ * Position of the first undelivered item is stored in <file>.pos after every delivered batch.
+ * When everything is delivered, the spool file is truncated.
+ *
+ * When delivery fails, it is repeated with exponential backoff. Items can be delivered
+ * twice after a crash, so the receiver should use idempotent IDs. Items permanently
+ * rejected by the receiver are moved to <file>.rejected (one JSON per line, the file
+ * can be imported later) and the delivery continues with next items.
+ */
+class Spooler {
+public:
+
+	///Item permanently rejected by the receiver
+	struct Rejected {
+		json::Value item;
+		std::string reason;
+	};
+
+	///Delivers the batch, returns items permanently rejected by the receiver
+	/** Throws exception when the delivery failed and should be repeated */
+	using SendFn = std::function<std::vector<Rejected>(const std::vector<json::Value> &)>;
+	///Reports errors
+	using ErrorFn = std::function<void(const std::string &)>;
+
+	///Construct spooler
+	/**
+	 * @param file path to the spool file
+	 * @param batchSize max count of items in single batch
+	 * @param send function which delivers the batch
+	 * @param error function which reports errors
+	 */
+	Spooler(const std::string &file, unsigned int batchSize, SendFn &&send, ErrorFn &&error);
+	~Spooler();
+
+	///Appends item to the spool
+	void push(const json::Value &item);
+	///Wakes the worker, delivery is retried immediately
+	void flush();
+	///Imports items of the file (for example unfinished file of the previous version) and deletes it
+	void import(const std::string &file);
+
+	static constexpr unsigned int minBackoff = 1000;
+	static constexpr unsigned int maxBackoff = 300000;
+
+protected:
+	std::string file;
+	std::string posFile;
+	std::string rejectFile;
+	unsigned int batchSize;
+	SendFn send;
+	ErrorFn error;
+
+	std::mutex lock;
+	std::condition_variable cond;
+	int fd = -1;
+	///position of the first undelivered item
+	std::size_t pos = 0;
+	///size of the spool
+	std::size_t size = 0;
+	bool stopped = false;
+	bool wake = false;
+	std::thread thr;
+
+	void worker();
+	///Reads batch starting at the position, returns position after the batch
+	std::size_t readBatch(std::size_t from, std::vector<json::Value> &batch);
+	void commit(std::size_t newpos);
+	void reject(const std::vector<Rejected> &items);
+	void writeAll(const std::string &data);
+};
+
+
+
+#endif /* SRC_REPORT_BROKER_SPOOLER_H_ */
@@ -55,6 +55,7 @@ public:
 	HTTPJson hjsn_utils;
 	std::unique_ptr<QuoteStream> qstream;
 	std::unique_ptr<Market> market;
+	PQuoteDistributor qdist;
 
 
 	double execCommand(const std::string &symbol, double amount, double last_price);
@@ -65,13 +66,13 @@ public:
 	PTradingEngine getEngine(const std::string &symbol) {
 		try {
 			if (market == nullptr) {
-				PQuoteDistributor qdist = new QuoteDistributor();
+				qdist = new QuoteDistributor();
 				qstream = std::make_unique<QuoteStream>(httpc,"https://web-quotes.simplefx.com/signalr/", qdist->createReceiveFn());
 				qdist->connect(qstream->connect());
 				market = std::make_unique<Market>(qdist, [this](const std::string &symbol, double amount, double last_price){
 					auto z = this->execCommand(symbol, amount, last_price);
 					return z;
-				});
+				}, secure_storage_path);
 			}
 			return market->getMarket(symbol);
 		} catch (...) {
@@ -113,6 +114,7 @@ public:
 	virtual json::Value setSettings(json::Value v) override;
 	virtual void restoreSettings(json::Value v) override;
 	virtual void setApiKey(json::Value keyData) override;
+	virtual PageData fetchPage(const std::string_view &method, const std::string_view &vpath, const PageData &pageData) override;
 
 	std::string authKey;
 	std::string authSecret;
@@ -763,6 +765,21 @@ inline void Interface::updatePositions() {
 }
 
 
+Interface::PageData Interface::fetchPage(const std::string_view &method, const std::string_view &vpath, const PageData &pageData) {
+	PageData resp;
+	if (vpath == "/quotes") {
+		if (method != "GET") {
+			resp.code = 405;
+			return resp;
+		}
+		resp.code = 200;
+		resp.headers.emplace_back("Content-Type","application/json");
+		resp.body = (qdist == nullptr?Value(json::object):qdist->getMetrics()).stringify().str();
+		return resp;
+	}
+	return AbstractBrokerAPI::fetchPage(method, vpath, pageData);
+}
+
 json::Value Interface::callMethod(std::string_view name, json::Value args) {
 	Sync _(lock);
 	return AbstractBrokerAPI::callMethod(name, args);
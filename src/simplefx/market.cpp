@@ -10,7 +10,19 @@
 
 #include "market.h"
 
-Market::Market(const PQuoteDistributor &qdist, CmdFn  &&cmdfn):qdist(qdist),cmdfn(std::move(cmdfn)) {
+#include <cctype>
+
+Market::Market(const PQuoteDistributor &qdist, CmdFn  &&cmdfn, std::string tradeLogPrefix)
+	:qdist(qdist),cmdfn(std::move(cmdfn)),tradeLogPrefix(std::move(tradeLogPrefix)) {
+}
+
+std::string Market::tradeLogPath(const std::string &symbol) const {
+	if (tradeLogPrefix.empty()) return std::string();
+	std::string res = tradeLogPrefix;
+	res.append(".");
+	for (char c: symbol) res.push_back(isalnum(c)?c:'_');
+	res.append(".trades");
+	return res;
 }
 
 PTradingEngine Market::getMarket(const std::string_view &symbol, bool create) {
@@ -19,7 +31,7 @@ PTradingEngine Market::getMarket(const std::string_view &symbol, bool create) {
 	if (m == nullptr && create) {
 		m = TradingEngine::create([this,s](double v, double p) {
 			return this->cmdfn(s, v, p);
-		});
+		}, tradeLogPath(s));
 		m->start(qdist->createRegFn(symbol));
 	}
 	return m;
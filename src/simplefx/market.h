@@ -15,7 +15,13 @@ class Market {
 public:
 	using CmdFn = std::function<double(const std::string &symbol, double amount, double last_price)>;
 
-	Market(const PQuoteDistributor &qdist, CmdFn  &&cmdfn);
+	///Construct market
+	/**
+	 * @param qdist quote distributor
+	 * @param cmdfn function which executes trades
+	 * @param tradeLogPrefix prefix of path where trade logs are stored. Empty disables persistence
+	 */
+	Market(const PQuoteDistributor &qdist, CmdFn  &&cmdfn, std::string tradeLogPrefix = std::string());
 
 	PTradingEngine getMarket(const std::string_view &symbol, bool create = true);
 
@@ -24,6 +30,9 @@ protected:
 	PQuoteDistributor qdist;
 	std::unordered_map<std::string, PTradingEngine> markets;
 	CmdFn cmdfn;
+	std::string tradeLogPrefix;
+
+	std::string tradeLogPath(const std::string &symbol) const;
 
 };
 
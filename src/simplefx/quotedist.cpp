@@ -7,62 +7,236 @@
 
 #include "quotedist.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <iterator>
+#include <imtjson/object.h>
+
+#include "tradingengine.h"
+
+QuoteDistributor::QuoteDistributor()
+	:core(std::make_shared<Core>())
+{
+	//the thread holds own reference to the state
+	dispatchThread = std::thread([core = core]{core->dispatcher();});
+}
+
+QuoteDistributor::~QuoteDistributor() {
+	core->stop();
+	//the last reference can be released by a listener, the dispatcher
+	//returns to the shared state, which is still alive
+	if (dispatchThread.get_id() == std::this_thread::get_id()) dispatchThread.detach();
+	else dispatchThread.join();
+}
+
 RegisterPriceChangeEvent QuoteDistributor::createRegFn(const std::string_view &symbol) {
 	return [me = PQuoteDistributor(this), symbol = std::string(symbol)](OnPriceChange &&fn) {
-		me->subscribe(symbol, std::move(fn));
+		me->core->subscribe(symbol, std::move(fn));
 	};
 }
 
 ReceiveQuotesFn QuoteDistributor::createReceiveFn() {
 	return [me = PQuoteDistributor(this)](std::string_view symbol, double bid, double ask, std::uint64_t time){
-		return me->receiveQuotes(symbol,bid,ask,time);
+		return me->core->receiveQuotes(symbol,bid,ask,time);
 	};
 }
 
 void QuoteDistributor::connect(SubscribeFn &&subfn) {
+	core->connect(std::move(subfn));
+}
+
+void QuoteDistributor::disconnect() {
+	core->disconnect();
+}
+
+json::Value QuoteDistributor::getMetrics() {
+	return core->getMetrics();
+}
+
+QuoteDistributor::Core::Core()
+	:symbolTable(std::make_shared<SymbolTable>()) {}
+
+void QuoteDistributor::Core::connect(SubscribeFn &&subfn) {
 	Sync _(lock);
 	this->subfn = std::move(subfn);
 }
 
-bool QuoteDistributor::receiveQuotes(const std::string_view &symbol, double bid, double ask, std::uint64_t time) {
-	Sync _(lock);
-	std::string s(symbol);
-	auto r = listeners.equal_range(s);
-	if (r.first == r.second) {
-		return false;
-	}
+void QuoteDistributor::Core::stop() {
+	std::unique_lock<std::mutex> _(dispatchLock);
+	stopped = true;
+	dispatchCond.notify_all();
+}
 
-	IStockApi::Ticker tk{
-			bid,
-			ask,
-			sqrt(bid*ask),
-			time
-		};
-
-	for (auto x = r.first; x != r.second;) {
-		if (!(*x).second(tk)) {
-			x = listeners.erase(x);
-		} else {
-			++x;
-		}
+bool QuoteDistributor::Core::receiveQuotes(const std::string_view &symbol, double bid, double ask, std::uint64_t time) {
+	PSymbolTable st = std::atomic_load(&symbolTable);
+	auto iter = st->byName.find(std::string(symbol));
+	if (iter == st->byName.end()) return false;
+	Symbol &smb = *iter->second;
+	PListeners lst = std::atomic_load(&smb.listeners);
+	if (lst == nullptr || lst->empty()) return false;
+
+	smb.quote.store(bid, ask, time);
+	metrics.received.fetch_add(1, std::memory_order_relaxed);
+
+	//already waiting for dispatch - the quote is conflated
+	if (smb.dirty.exchange(true)) {
+		metrics.conflated.fetch_add(1, std::memory_order_relaxed);
+		return true;
 	}
+	smb.recvTime = steadyNow();
+
+	std::unique_lock<std::mutex> _(dispatchLock);
+	dirtyList.push_back(&smb);
+	dispatchCond.notify_one();
 	return true;
 }
 
-void QuoteDistributor::subscribe(const std::string_view &symbol, OnPriceChange &&listener) {
+void QuoteDistributor::Core::subscribe(const std::string_view &symbol, OnPriceChange &&listener) {
 	Sync _(lock);
 
-	std::string s (symbol);
+	Symbol &smb = intern(std::string(symbol));
+	PListeners cur = std::atomic_load(&smb.listeners);
+	auto nw = cur == nullptr?std::make_shared<Listeners>():std::make_shared<Listeners>(*cur);
+	nw->push_back(std::make_shared<OnPriceChange>(std::move(listener)));
+	std::atomic_store(&smb.listeners, PListeners(nw));
 
-	auto r = listeners.equal_range(s);
-	if (r.first == r.second) {
+	if (nw->size() == 1 && subfn != nullptr) {
 		subfn(symbol);
 	}
+}
+
+void QuoteDistributor::Core::unsubscribe(Symbol &smb, const Listeners &rejected) {
+	Sync _(lock);
 
-	listeners.emplace(std::move(s), std::move(listener));
+	PListeners cur = std::atomic_load(&smb.listeners);
+	auto nw = std::make_shared<Listeners>();
+	std::copy_if(cur->begin(), cur->end(), std::back_inserter(*nw), [&](const PListener &l) {
+		return std::find(rejected.begin(), rejected.end(), l) == rejected.end();
+	});
+	std::atomic_store(&smb.listeners, PListeners(nw));
 }
 
-void QuoteDistributor::disconnect() {
+QuoteDistributor::Symbol &QuoteDistributor::Core::intern(const std::string &symbol) {
+	PSymbolTable st = std::atomic_load(&symbolTable);
+	auto iter = st->byName.find(symbol);
+	if (iter != st->byName.end()) return *iter->second;
+
+	auto smb = std::make_unique<Symbol>();
+	smb->name = symbol;
+	Symbol *ptr = smb.get();
+	symbols.push_back(std::move(smb));
+
+	auto nw = std::make_shared<SymbolTable>(*st);
+	nw->byName.emplace(symbol, ptr);
+	std::atomic_store(&symbolTable, PSymbolTable(nw));
+	return *ptr;
+}
+
+void QuoteDistributor::Core::disconnect() {
+	Sync _(lock);
 	subfn = nullptr;
 }
+
+void QuoteDistributor::Core::dispatcher() {
+	std::vector<Symbol *> batch;
+	std::unique_lock<std::mutex> lk(dispatchLock);
+	while (!stopped) {
+		dispatchCond.wait(lk, [&]{return !dirtyList.empty() || stopped;});
+		if (stopped) break;
+		std::swap(batch, dirtyList);
+		lk.unlock();
+		dispatch(batch);
+		batch.clear();
+		lk.lock();
+	}
+}
+
+void QuoteDistributor::Core::dispatch(const std::vector<Symbol *> &batch) {
+	Listeners rejected;
+	std::uint64_t latencySum = 0, latencyMax = 0;
+	std::uint64_t feedLatencySum = 0, feedLatencyMax = 0;
+	for (Symbol *smb: batch) {
+		std::uint64_t recvTime = smb->recvTime;
+		//clear flag before the quote is read, so next quote is scheduled again
+		smb->dirty.store(false);
+		IStockApi::Ticker tk;
+		smb->quote.load(tk);
+
+		PListeners lst = std::atomic_load(&smb->listeners);
+		if (lst != nullptr) {
+			for (const PListener &l: *lst) {
+				if (!(*l)(tk)) rejected.push_back(l);
+			}
+			if (!rejected.empty()) {
+				unsubscribe(*smb, rejected);
+				rejected.clear();
+			}
+		}
+
+		std::uint64_t latency = steadyNow() - recvTime;
+		latencySum += latency;
+		latencyMax = std::max(latencyMax, latency);
+		std::uint64_t now = TradingEngine::now();
+		std::uint64_t feedLatency = now > tk.time?now - tk.time:0;
+		feedLatencySum += feedLatency;
+		feedLatencyMax = std::max(feedLatencyMax, feedLatency);
+	}
+
+	std::unique_lock<std::mutex> _(metricsLock);
+	metrics.dispatched += batch.size();
+	metrics.batches++;
+	metrics.maxBatch = std::max(metrics.maxBatch, batch.size());
+	metrics.latencySum += latencySum;
+	metrics.latencyMax = std::max(metrics.latencyMax, latencyMax);
+	metrics.feedLatencySum += feedLatencySum;
+	metrics.feedLatencyMax = std::max(metrics.feedLatencyMax, feedLatencyMax);
+}
+
+json::Value QuoteDistributor::Core::getMetrics() {
+	std::unique_lock<std::mutex> _(metricsLock);
+	std::uint64_t dispatched = metrics.dispatched;
+	json::Value res = json::Object
+			("received", metrics.received.load())
+			("conflated", metrics.conflated.load())
+			("dispatched", dispatched)
+			("batches", metrics.batches)
+			("max_batch", metrics.maxBatch)
+			("avg_latency_us", dispatched?metrics.latencySum/dispatched:0)
+			("max_latency_us", metrics.latencyMax)
+			("avg_feed_latency_ms", dispatched?metrics.feedLatencySum/dispatched:0)
+			("max_feed_latency_ms", metrics.feedLatencyMax);
+	metrics.maxBatch = 0;
+	metrics.latencyMax = 0;
+	metrics.feedLatencyMax = 0;
+	return res;
+}
+
+std::uint64_t QuoteDistributor::steadyNow() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void QuoteDistributor::QuoteSlot::store(double bid, double ask, std::uint64_t time) {
+	unsigned int s = seq.load(std::memory_order_relaxed);
+	seq.store(s+1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	this->bid.store(bid, std::memory_order_relaxed);
+	this->ask.store(ask, std::memory_order_relaxed);
+	this->time.store(time, std::memory_order_relaxed);
+	seq.store(s+2, std::memory_order_release);
+}
+
+unsigned int QuoteDistributor::QuoteSlot::load(IStockApi::Ticker &tk) const {
+	unsigned int s1, s2;
+	do {
+		s1 = seq.load(std::memory_order_acquire);
+		tk.bid = bid.load(std::memory_order_relaxed);
+		tk.ask = ask.load(std::memory_order_relaxed);
+		tk.time = time.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		s2 = seq.load(std::memory_order_relaxed);
+	} while (s1 != s2 || (s1 & 1));
+	tk.last = std::sqrt(tk.bid*tk.ask);
+	return s1;
+}
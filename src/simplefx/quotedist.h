@@ -8,36 +8,153 @@
 #ifndef SRC_SIMPLEFX_QUOTEDIST_H_
 #define SRC_SIMPLEFX_QUOTEDIST_H_
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 #include "datasrc.h"
 #include "fndef.h"
+#include "../shared/refcnt.h"
 
 class QuoteDistributor;
 using PQuoteDistributor = ondra_shared::RefCntPtr<QuoteDistributor>;
 
+///Distributes quotes from the stream to the listeners
+/**
+ * Quotes are received on the stream's thread, which only stores the quote
+ * to the symbol's slot and marks the symbol dirty. The dispatcher thread drains
+ * dirty symbols in batches and notifies listeners without holding any lock of
+ * the distributor, so slow listener never blocks the stream. Quotes received
+ * while the symbol is waiting for the dispatch are conflated - only the latest
+ * quote is delivered.
+ *
+ * Listener can release the last reference to the distributor. The distributor
+ * is then destroyed on the dispatcher thread, so the dispatcher works with
+ * the shared state, which is released when the dispatcher exits
+ */
 class QuoteDistributor: public ondra_shared::RefCntObj {
 public:
 
+	QuoteDistributor();
+	~QuoteDistributor();
+
 	RegisterPriceChangeEvent createRegFn(const std::string_view &symbol);
 	ReceiveQuotesFn createReceiveFn();
 	void connect(SubscribeFn &&subfn);
 	void disconnect();
 
+	///Retrieves metrics of the quote pipeline
+	/** Maximums are reset after each call */
+	json::Value getMetrics();
+
 
 protected:
 
-	std::recursive_mutex lock;
-	using Sync = std::unique_lock<std::recursive_mutex>;
+	///Holds latest quote. Single writer, multiple readers (seqlock)
+	class QuoteSlot {
+	public:
+		void store(double bid, double ask, std::uint64_t time);
+		///Reads quote
+		/**
+		 * @param tk receives quote
+		 * @return version of the quote
+		 */
+		unsigned int load(IStockApi::Ticker &tk) const;
+
+	protected:
+		std::atomic<unsigned int> seq{0};
+		std::atomic<double> bid{0};
+		std::atomic<double> ask{0};
+		std::atomic<std::uint64_t> time{0};
+	};
+
+	using PListener = std::shared_ptr<OnPriceChange>;
+	using Listeners = std::vector<PListener>;
+	using PListeners = std::shared_ptr<const Listeners>;
+
+	struct Symbol {
+		std::string name;
+		QuoteSlot quote;
+		///Current listeners - replaced as whole (copy on write), use atomic_load/store
+		PListeners listeners;
+		///Symbol is waiting for dispatch
+		std::atomic<bool> dirty{false};
+		///Time when the first not yet dispatched quote was received (steady clock, in microseconds)
+		std::uint64_t recvTime = 0;
+	};
+
+	///Interned symbols. Table is replaced as whole when new symbol is added
+	struct SymbolTable {
+		std::unordered_map<std::string, Symbol *> byName;
+	};
+
+	struct Metrics {
+		///count of quotes received from the stream
+		std::atomic<std::uint64_t> received{0};
+		///count of quotes replaced by newer quote before they were dispatched
+		std::atomic<std::uint64_t> conflated{0};
+		///count of dispatched quotes
+		std::uint64_t dispatched = 0;
+		///count of dispatched batches
+		std::uint64_t batches = 0;
+		std::size_t maxBatch = 0;
+		///time between receiving and dispatching the quote (in microseconds)
+		std::uint64_t latencySum = 0;
+		std::uint64_t latencyMax = 0;
+		///time between quote creation on the exchange and dispatching (in milliseconds)
+		std::uint64_t feedLatencySum = 0;
+		std::uint64_t feedLatencyMax = 0;
+	};
+
+	using PSymbolTable = std::shared_ptr<const SymbolTable>;
+
+	///State of the distributor shared with the dispatcher thread
+	class Core {
+	public:
+		Core();
+
+		bool receiveQuotes(const std::string_view &symbol, double bid, double ask, std::uint64_t time);
+		void subscribe(const std::string_view &symbol, OnPriceChange &&listener);
+		void connect(SubscribeFn &&subfn);
+		void disconnect();
+		json::Value getMetrics();
+
+		///Runs the dispatcher until stop() is called
+		void dispatcher();
+		///Stops the dispatcher, it can be called from the dispatcher thread
+		void stop();
+
+	protected:
+		///Protects changes of the symbol table and listeners
+		std::mutex lock;
+		using Sync = std::unique_lock<std::mutex>;
+
+		SubscribeFn subfn;
+
+		std::vector<std::unique_ptr<Symbol> > symbols;
+		PSymbolTable symbolTable;
 
-	SubscribeFn subfn;
+		std::mutex dispatchLock;
+		std::condition_variable dispatchCond;
+		std::vector<Symbol *> dirtyList;
+		bool stopped = false;
 
-	std::unordered_multimap<std::string, OnPriceChange> listeners;
+		Metrics metrics;
+		///Protects non-atomic part of the metrics
+		std::mutex metricsLock;
 
-	bool receiveQuotes(const std::string_view &symbol, double bid, double ask, std::uint64_t time);
-	void subscribe(const std::string_view &symbol, OnPriceChange &&listener);
+		void unsubscribe(Symbol &smb, const Listeners &rejected);
+		Symbol &intern(const std::string &symbol);
+		void dispatch(const std::vector<Symbol *> &batch);
+	};
 
+	std::shared_ptr<Core> core;
+	std::thread dispatchThread;
 
+	static std::uint64_t steadyNow();
 };
 
 #endif /* SRC_SIMPLEFX_QUOTEDIST_H_ */
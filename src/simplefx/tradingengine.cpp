@@ -7,7 +7,10 @@
 
 #include "tradingengine.h"
 #include <imtjson/string.h>
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <fstream>
 #include "lexid.h"
 
 
@@ -18,10 +21,12 @@ using ondra_shared::logError;
 using ondra_shared::logNote;
 using ondra_shared::logWarning;
 
-TradingEngine::TradingEngine(Command &&cmdFn)
-	:cmdFn(std::move(cmdFn)),ticker{0,0,0,0}
+TradingEngine::TradingEngine(Command &&cmdFn, std::string tradeLog)
+	:cmdFn(std::move(cmdFn)),tradeLog(std::move(tradeLog)),ticker{0,0,0,0}
 {
 	uidcnt = now();
+	loadTrades();
+	if (!trades.empty()) uidcnt = std::max(uidcnt, trades.back().id+1);
 }
 
 
@@ -34,7 +39,7 @@ void TradingEngine::startListenPrices() const {
 	Sync _(lock);
 	starter([me = PTradingEngine(const_cast<TradingEngine *>(this))](const IStockApi::Ticker &price) {
 		Sync _(me->lock);
-		if (me->orders.empty() && me->quoteStop < now()) {
+		if (me->orderIndex.empty() && me->quoteStop < now()) {
 			me->quotesStopped=true;
 			return false;
 		}
@@ -54,47 +59,59 @@ IStockApi::Ticker TradingEngine::getTicker() const {
 void TradingEngine::readOrders(std::function<void(IStockApi::Order)> &&cb) {
 	Sync _(lock);
 	runQuotes();
-	for (auto &&o : orders) {
-		cb(o);
+	for (auto &&o : buyOrders) {
+		cb(o.second);
 	}
+	for (auto &&o : sellOrders) {
+		cb(o.second);
+	}
+}
+
+template<typename T>
+std::string UIDToString(T val) {
+	return lexID::create(val);
 }
 
 std::string TradingEngine::readTrades(const std::string &fromId, std::function<void(IStockApi::Trade)> &&cb) {
 	Sync _(lock);
 	runQuotes();
+	//no trades seen yet, start at current position
+	if (fromId.empty()) return UIDToString(uidcnt-1);
+
+	UID from = lexID::parse<UID>(fromId, 0);
+	auto iter = std::upper_bound(trades.begin(), trades.end(), from, [](UID id, const Trade &t) {
+		return id < t.id;
+	});
 	auto last = fromId;
-	for (auto &&t : trades) {
-		if (t.id > fromId) {cb(IStockApi::Trade {
-			t.id,
+	for (; iter != trades.end(); ++iter) {
+		const Trade &t = *iter;
+		last = UIDToString(t.id);
+		cb(IStockApi::Trade {
+			last,
 			t.timestamp,
 			t.size,
 			t.price,
 			t.size,
 			t.price
 		});
-		last = t.id;
-		}
 	}
 	return last;
 }
 
-template<typename T>
-std::string UIDToString(T val) {
-	return lexID::create(val);
-}
-
 std::string TradingEngine::placeOrder(double price, double size, json::Value clientId,const std::string *replace ) {
 	Sync _(lock);
 	runQuotes();
 	if (replace) cancelOrder(*replace);
 	if (size) {
 		std::string oid = UIDToString(uidcnt++);
-		orders.push_back(Order {
+		OrderBook &book = size > 0?buyOrders:sellOrders;
+		auto iter = book.emplace(price, Order {
 			oid,
 			clientId,
 			size,
 			price
 		});
+		orderIndex.emplace(oid, iter);
 		logDebug("Order placed $1 at price $2 size $3", oid, price, size);
 		updateMinMaxPrice();
 		return oid;
@@ -105,12 +122,14 @@ std::string TradingEngine::placeOrder(double price, double size, json::Value cli
 
 void TradingEngine::cancelOrder(std::string id) {
 	Sync _(lock);
-	auto iter = std::find_if(orders.begin(), orders.end(), [&](const Order &o) {
-		return o.id.getString() == json::StrViewA(id);
-	});
-	if (iter != orders.end()) {
+	auto iter = orderIndex.find(id);
+	if (iter != orderIndex.end()) {
 		logDebug("Order canceled: $1", id);
-		orders.erase(iter);
+		auto oiter = iter->second;
+		if (oiter->second.size > 0) buyOrders.erase(oiter);
+		else sellOrders.erase(oiter);
+		orderIndex.erase(iter);
+		updateMinMaxPrice();
 	} else {
 		logWarning("Order cancel not found: $1", id);
 	}
@@ -122,7 +141,7 @@ void TradingEngine::executeTrade(double volume, double price) {
 		if (execprice <= 0) return;
 		Sync _(lock);
 		logDebug("Executed total $1 at price $2", volume, execprice);
-		trades.push_back(Trade { UIDToString(uidcnt++), execprice, volume, now() });
+		recordTrade(execprice, volume);
 	} catch (std::exception &e) {
 		logError("Execution failed: $1", e.what());
 	}
@@ -131,7 +150,84 @@ void TradingEngine::executeTrade(double volume, double price) {
 void TradingEngine::addTrade(double volume) {
 	Sync _(lock);
 	logDebug("Added trade: price=$1, size=$2", ticker.last, volume);
-	trades.push_back(Trade { UIDToString(uidcnt++), ticker.last, volume, now() });
+	recordTrade(ticker.last, volume);
+}
+
+void TradingEngine::recordTrade(double price, double volume) {
+	trades.push_back(Trade { uidcnt++, price, volume, now() });
+	if (pruneTrades()) saveTrades();
+	else appendTrade(trades.back());
+}
+
+bool TradingEngine::pruneTrades() {
+	auto tm = now();
+	bool pruned = false;
+	//prune in batches, so the log is not rewritten on every trade
+	if (trades.size() > maxTrades + maxTrades/4) {
+		trades.erase(trades.begin(), trades.end() - maxTrades);
+		pruned = true;
+	}
+	while (!trades.empty() && trades.front().timestamp + maxTradeAge < tm) {
+		trades.pop_front();
+		pruned = true;
+	}
+	return pruned;
+}
+
+void TradingEngine::loadTrades() {
+	if (tradeLog.empty()) return;
+	std::ifstream in(tradeLog);
+	if (!in) return;
+	std::string line;
+	while (std::getline(in, line)) {
+		if (line.empty()) continue;
+		try {
+			json::Value v = json::Value::fromString(line);
+			Trade t {v[0].getUIntLong(), v[1].getNumber(), v[2].getNumber(), v[3].getUIntLong()};
+			if (trades.empty() || trades.back().id < t.id) trades.push_back(t);
+		} catch (std::exception &e) {
+			logWarning("Trade log $1: skipped invalid record - $2", tradeLog, e.what());
+		}
+	}
+	in.close();
+	if (pruneTrades()) saveTrades();
+}
+
+void TradingEngine::appendTrade(const Trade &t) {
+	if (tradeLog.empty()) return;
+	//the log stays open, it is reopened only after it is rewritten
+	if (!logFile.is_open()) {
+		logFile.open(tradeLog, std::ios::app);
+		if (!logFile) {
+			logError("Failed to open trade log: $1", tradeLog);
+			logFile.close();
+			return;
+		}
+	}
+	json::Value({t.id, t.price, t.size, t.timestamp}).toStream(logFile);
+	logFile << std::endl;
+	if (!logFile) {
+		logError("Failed to write trade log: $1", tradeLog);
+		logFile.close();
+	}
+}
+
+void TradingEngine::saveTrades() {
+	if (tradeLog.empty()) return;
+	logFile.close();
+	std::string tmp = tradeLog + ".tmp";
+	{
+		std::ofstream out(tmp, std::ios::trunc);
+		for (auto &&t: trades) {
+			json::Value({t.id, t.price, t.size, t.timestamp}).toStream(out);
+			out << std::endl;
+		}
+		if (!out) {
+			logError("Failed to write trade log: $1", tmp);
+			return;
+		}
+	}
+	std::rename(tmp.c_str(), tradeLog.c_str());
 }
 
 void TradingEngine::onPriceChange(const IStockApi::Ticker &price, Sync &hlck) {
@@ -147,18 +243,26 @@ void TradingEngine::onPriceChange(const IStockApi::Ticker &price, Sync &hlck) {
 	logDebug("Quote received: ask: $1, bid $2", ticker.ask, ticker.bid);
 
 	if (ticker.ask < minPrice || ticker.bid > maxPrice) {
-		std::vector<Order> pending;
-		pending.reserve(orders.size());
-		for (auto &&order: orders) {
-			if ((order.size < 0 && order.price < ticker.bid)
-					|| (order.size > 0 && order.price > ticker.ask)) {
-				volume += order.size;
-				logDebug("Matching order $1 at $2 size $3", order.id.toString(), order.price, order.size);
-			} else {
-				pending.push_back(order);
-			}
+		//buy orders - the highest price is at the end
+		while (!buyOrders.empty()) {
+			auto iter = std::prev(buyOrders.end());
+			const Order &order = iter->second;
+			if (order.price <= ticker.ask) break;
+			volume += order.size;
+			logDebug("Matching order $1 at $2 size $3", order.id.toString(), order.price, order.size);
+			orderIndex.erase(std::string(order.id.getString()));
+			buyOrders.erase(iter);
+		}
+		//sell orders - the lowest price is at the beginning
+		while (!sellOrders.empty()) {
+			auto iter = sellOrders.begin();
+			const Order &order = iter->second;
+			if (order.price >= ticker.bid) break;
+			volume += order.size;
+			logDebug("Matching order $1 at $2 size $3", order.id.toString(), order.price, order.size);
+			orderIndex.erase(std::string(order.id.getString()));
+			sellOrders.erase(iter);
 		}
-		std::swap(pending, orders);
 		updateMinMaxPrice();
 	}
 	tickerWait.notify_all();
@@ -172,23 +276,26 @@ void TradingEngine::onPriceChange(const IStockApi::Ticker &price, Sync &hlck) {
 }
 
 void TradingEngine::updateMinMaxPrice() {
-	minPrice = 0;
-	maxPrice = std::numeric_limits<double>::max();
-	for (auto &&o: orders) {
-		if (o.size > 0) minPrice = std::max(minPrice, o.price);
-		else maxPrice = std::min(maxPrice,o.price);
-	}
+	minPrice = buyOrders.empty()?0:std::prev(buyOrders.end())->first;
+	maxPrice = sellOrders.empty()?std::numeric_limits<double>::max():sellOrders.begin()->first;
 	logDebug("Spread range updated: $1 - $2", minPrice, maxPrice);
 }
 
 void TradingEngine::stop() {
 	Sync _(lock);
-	orders.clear();
+	clearOrders();
 	quoteStop = 0;
 }
 
-PTradingEngine TradingEngine::create(Command &&cmdIfc) {
-	return new TradingEngine(std::move(cmdIfc));
+void TradingEngine::clearOrders() {
+	buyOrders.clear();
+	sellOrders.clear();
+	orderIndex.clear();
+	updateMinMaxPrice();
+}
+
+PTradingEngine TradingEngine::create(Command &&cmdIfc, std::string tradeLog) {
+	return new TradingEngine(std::move(cmdIfc), std::move(tradeLog));
 }
 
 
@@ -205,6 +312,6 @@ void TradingEngine::runQuotes() const {
 void TradingEngine::runSettlement(double amount) {
 	Sync _(lock);
 	logNote("Settlement $1", amount);
-	orders.clear();
+	clearOrders();
 	executeTrade(amount, ticker.last);
 }
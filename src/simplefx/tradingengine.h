@@ -11,7 +11,11 @@
 
 #include "fndef.h"
 #include <cstdint>
+#include <deque>
+#include <fstream>
+#include <map>
 #include <mutex>
+#include <unordered_map>
 #include <vector>
 
 #include "../brokers/api.h"
@@ -25,7 +29,12 @@ using PTradingEngine = ondra_shared::RefCntPtr<TradingEngine>;
 
 class TradingEngine: public ondra_shared::RefCntObj {
 public:
-	TradingEngine(Command &&cmdFn);
+	///Construct trading engine
+	/**
+	 * @param cmdFn function which executes trades
+	 * @param tradeLog path to file where trades are persisted. If empty, trades are not persisted
+	 */
+	TradingEngine(Command &&cmdFn, std::string tradeLog = std::string());
 
 	using UID = std::uint64_t;
 
@@ -39,19 +48,24 @@ public:
 	void readOrders(std::function<void(IStockApi::Order)> &&cb);
 	IStockApi::Ticker getTicker() const;
 
-	static PTradingEngine create(Command &&cmdIfc);
+	static PTradingEngine create(Command &&cmdIfc, std::string tradeLog = std::string());
 
 	static std::uint64_t now();
 
 	void addTrade(double volume);
 
+	///Maximum count of trades kept in the trade log
+	static constexpr std::size_t maxTrades = 1000;
+	///Maximum age of trades kept in the trade log (30 days)
+	static constexpr std::uint64_t maxTradeAge = 30*24*3600*std::uint64_t(1000);
+
 protected:
 
 	Command cmdFn;
 
 
 	struct Trade {
-		std::string id;
+		UID id;
 		double price;
 		double size;
 		std::uint64_t timestamp;
@@ -62,8 +76,19 @@ protected:
 	double maxPrice = 1e99;
 	void updateMinMaxPrice();
 
-	std::vector<Order> orders;
-	std::vector<Trade> trades;
+	///Orders sorted by price. Buy orders are matched from the end, sell orders from the beginning
+	using OrderBook = std::multimap<double, Order>;
+	OrderBook buyOrders;
+	OrderBook sellOrders;
+	///Index of orders by id
+	std::unordered_map<std::string, OrderBook::iterator> orderIndex;
+
+	void clearOrders();
+	///Trades ordered by id (ids are monotonic)
+	std::deque<Trade> trades;
+	std::string tradeLog;
+	///trade log opened for appending
+	std::ofstream logFile;
 	mutable std::recursive_mutex lock;
 	using Sync = std::unique_lock<std::recursive_mutex>;
 	mutable std::condition_variable_any tickerWait;
@@ -82,6 +107,12 @@ protected:
 	mutable bool quotesStopped = true;
 	void runQuotes() const;
 	void executeTrade(double volume, double price);
+	void recordTrade(double price, double volume);
+
+	void loadTrades();
+	void saveTrades();
+	void appendTrade(const Trade &t);
+	bool pruneTrades();
 };
 
 
@@ -10,6 +10,7 @@
 #include <simpleServer/urlencode.h>
 #include <imtjson/value.h>
 #include <imtjson/object.h>
+#include <imtjson/array.h>
 #include "../shared/default_app.h"
 #include "../brokers/httpjson.h"
 #include "../shared/countdown.h"
@@ -102,6 +103,20 @@ int main(int argc, char **argv) {
 					Value content = data[1];
 					httpc.SEND(replacePlaceholder(cfg.putUrl,"%name%",name.getString()),cfg.putMethod,content);
 					resp = Value(json::array,{true});
+				} else if (cmd == "storeMany") {
+					//{"store":[[name, content],...], "erase":[name,...]}
+					json::Array res;
+					for (Value item: req[1]["store"]) {
+						Value name = item[0];
+						Value content = item[1];
+						httpc.SEND(replacePlaceholder(cfg.putUrl,"%name%",name.getString()),cfg.putMethod,content);
+						res.push_back(true);
+					}
+					for (Value name: req[1]["erase"]) {
+						httpc.SEND(replacePlaceholder(cfg.delUrl,"%name%", name.getString()),cfg.delMethod,"");
+						res.push_back(true);
+					}
+					resp = {true, res};
 				} else if (cmd == "load") {
 					Value name = req[1];
 					Value r = httpc.GET(replacePlaceholder(cfg.getUrl,"%name%", name.getString()));
@@ -0,0 +1,199 @@
+/*
+ * fillmodel_test.cpp
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <imtjson/value.h>
+
+#include "../main/emulator.h"
+#include "../main/fillmodel.h"
+
+static bool near(double a, double b) {
+	return std::abs(a - b) < 1e-9;
+}
+
+static bool check(bool cond, const char *msg) {
+	if (!cond) std::cerr << msg << std::endl;
+	return cond;
+}
+
+static IStockApi::Ticker ticker(double last, std::uint64_t time) {
+	return IStockApi::Ticker{last, last, last, time};
+}
+
+///Data source of the emulator, returns the ticker set by the test
+class ScriptedSource: public IStockApi {
+public:
+	Ticker tk = ticker(105, 1000);
+	double minSize = 0;
+
+	virtual double getBalance(const std::string_view & symb, const std::string_view &) override {
+		return symb == "USD"?1000:0;
+	}
+	virtual TradesSync syncTrades(json::Value, const std::string_view &) override {return {};}
+	virtual Orders getOpenOrders(const std::string_view &) override {return {};}
+	virtual Ticker getTicker(const std::string_view &) override {return tk;}
+	virtual json::Value placeOrder(const std::string_view &, double, double, json::Value, json::Value, double) override {
+		return json::Value();
+	}
+	virtual bool reset() override {return true;}
+	virtual MarketInfo getMarketInfo(const std::string_view &) override {
+		MarketInfo nfo;
+		nfo.asset_symbol = "BTC";
+		nfo.currency_symbol = "USD";
+		nfo.asset_step = 0.0001;
+		nfo.currency_step = 0.01;
+		nfo.min_size = minSize;
+		nfo.min_volume = 0;
+		nfo.fees = 0;
+		return nfo;
+	}
+	virtual double getFees(const std::string_view &) override {return 0.0025;}
+	virtual std::vector<std::string> getAllPairs() override {return {"TEST"};}
+	virtual void testBroker() override {}
+	virtual BrokerInfo getBrokerInfo() override {return BrokerInfo{true, "test"};}
+};
+
+///Instant model fills whole order once the price crosses it
+static bool testInstant() {
+	FillModel::Config cfg;
+	FillModel fm(cfg);
+	auto st = fm.place(0);
+	bool ok = check(fm.fill(st, 2, 100, ticker(100.5, 1000), 1000) == 0, "instant: buy filled above its price");
+	ok = check(fm.fill(st, 2, 100, ticker(100, 2000), 1000) == 2, "instant: buy was not filled at its price") && ok;
+	ok = check(fm.fill(st, -2, 100, ticker(99.5, 3000), 1000) == 0, "instant: sell filled below its price") && ok;
+	ok = check(fm.fill(st, -2, 100, ticker(101, 4000), 1000) == -2, "instant: sell was not filled") && ok;
+	return ok;
+}
+
+///Queue model consumes the volume in front of the order first, then fills the order partially
+static bool testQueue() {
+	FillModel::Config cfg;
+	cfg.type = FillModel::Config::queue;
+	cfg.volume = 1;
+	cfg.queue = 0.5;
+	cfg.sweep = 0.01;
+	FillModel fm(cfg);
+	auto st = fm.place(0);
+	bool ok = check(near(fm.fill(st, 2, 100, ticker(100, 60000), 60000), 0.5), "queue: first minute must fill 0.5");
+	ok = check(near(st.queue, 0), "queue: queue was not consumed") && ok;
+	ok = check(near(fm.fill(st, 1.5, 100, ticker(100, 120000), 60000), 1), "queue: second minute must fill 1") && ok;
+	ok = check(near(fm.fill(st, -1, 100, ticker(100, 150000), 30000), -0.5), "queue: sell must fill -0.5") && ok;
+	return ok;
+}
+
+///Price which penetrates the order deeper than sweep fills it completely
+static bool testSweep() {
+	FillModel::Config cfg;
+	cfg.type = FillModel::Config::queue;
+	cfg.volume = 1;
+	cfg.queue = 10;
+	cfg.sweep = 0.01;
+	FillModel fm(cfg);
+	auto st = fm.place(0);
+	bool ok = check(fm.fill(st, 2, 100, ticker(99.5, 1000), 1000) == 0, "sweep: shallow penetration filled the queued order");
+	ok = check(fm.fill(st, 2, 100, ticker(98.9, 2000), 1000) == 2, "sweep: deep penetration didn't fill the order") && ok;
+	ok = check(fm.fill(st, -2, 100, ticker(101.1, 3000), 1000) == -2, "sweep: deep penetration didn't fill the sell") && ok;
+	return ok;
+}
+
+///Order is not filled before it appears on the orderbook, time before is not counted
+static bool testLatency() {
+	FillModel::Config cfg;
+	cfg.latency = 5000;
+	FillModel fm(cfg);
+	auto st = fm.place(1000);
+	bool ok = check(fm.fill(st, 1, 100, ticker(99, 3000), 2000) == 0, "latency: order filled before it was active");
+	ok = check(fm.fill(st, 1, 100, ticker(99, 6000), 3000) == 1, "latency: active order was not filled") && ok;
+
+	cfg.type = FillModel::Config::queue;
+	cfg.volume = 60;
+	cfg.latency = 10000;
+	FillModel fmq(cfg);
+	st = fmq.place(0);
+	ok = check(near(fmq.fill(st, 100, 100, ticker(100, 20000), 20000), 10), "latency: volume counted before the order was active") && ok;
+	return ok;
+}
+
+///Backtest fill is limited by latency, queue and volume
+static bool testFillAtPrice() {
+	FillModel::Config cfg;
+	cfg.type = FillModel::Config::queue;
+	cfg.latency = 1000;
+	cfg.volume = 60;
+	cfg.queue = 5;
+	FillModel fm(cfg);
+	bool ok = check(fm.fillAtPrice(100, 500) == 0, "fillAtPrice: filled before latency");
+	ok = check(fm.fillAtPrice(100, 5000) == 0, "fillAtPrice: filled inside the queue") && ok;
+	ok = check(near(fm.fillAtPrice(100, 11000), 5), "fillAtPrice: buy must fill 5") && ok;
+	ok = check(near(fm.fillAtPrice(-100, 11000), -5), "fillAtPrice: sell must fill -5") && ok;
+	cfg.type = FillModel::Config::instant;
+	FillModel fmi(cfg);
+	ok = check(fmi.fillAtPrice(100, 1000) == 100, "fillAtPrice: instant model must fill all") && ok;
+	return ok;
+}
+
+///Fees follow the tier of the volume traded during last 30 days
+static bool testFeeTiers() {
+	FillModel::Config cfg;
+	FillModel fm0(cfg);
+	fm0.addVolume(0, 1e9);
+	bool ok = check(fm0.getFees(0.0025) == 0.0025, "fees: broker fees were not used without tiers");
+
+	cfg.fee_tiers = {{0, 0.002}, {1000, 0.001}};
+	FillModel fm(cfg);
+	ok = check(fm.getFees(0.0025) == 0.002, "fees: first tier was not used") && ok;
+	fm.addVolume(0, 600);
+	fm.addVolume(1000, -500);
+	ok = check(fm.getFees(0.0025) == 0.001, "fees: second tier was not reached") && ok;
+	fm.addVolume(31*24*3600*std::uint64_t(1000), 10);
+	ok = check(fm.getFees(0.0025) == 0.002, "fees: old volume was not expired") && ok;
+	return ok;
+}
+
+///Emulator fills the order partially and doesn't leave dust on the orderbook
+static bool testEmulatorPartial() {
+	ScriptedSource src;
+	src.minSize = 0.6;
+	FillModel::Config cfg;
+	cfg.type = FillModel::Config::queue;
+	cfg.volume = 1;
+	cfg.queue = 0.5;
+	cfg.sweep = 0.01;
+	EmulatorAPI emul(src, 1000, cfg);
+	emul.getMarketInfo("TEST");
+	emul.getBalance("BTC", "TEST");
+	emul.getBalance("USD", "TEST");
+	emul.getTicker("TEST");
+	emul.placeOrder("TEST", 2, 100, json::Value(), json::Value(), 0);
+
+	src.tk = ticker(100, 61000);
+	auto orders = emul.getOpenOrders("TEST");
+	bool ok = check(orders.size() == 1 && near(orders[0].size, 1.5), "emulator: first fill must leave 1.5");
+	//fill of 1 would leave 0.5, which is below min_size, so the order is filled completely
+	src.tk = ticker(100, 121000);
+	orders = emul.getOpenOrders("TEST");
+	ok = check(orders.empty(), "emulator: dust left on the orderbook") && ok;
+
+	auto trades = emul.syncTrades(json::Value(), "TEST").trades;
+	ok = check(trades.size() == 2 && near(trades[0].size, 0.5) && near(trades[1].size, 1.5), "emulator: unexpected trades") && ok;
+	ok = check(near(emul.getBalance("BTC", "TEST"), 2), "emulator: unexpected balance") && ok;
+	ok = check(near(emul.getBalance("USD", "TEST"), 800), "emulator: unexpected currency") && ok;
+	return ok;
+}
+
+int main() {
+	bool ok = testInstant();
+	ok = testQueue() && ok;
+	ok = testSweep() && ok;
+	ok = testLatency() && ok;
+	ok = testFillAtPrice() && ok;
+	ok = testFeeTiers() && ok;
+	ok = testEmulatorPartial() && ok;
+	std::cout << (ok?"OK":"FAILED") << std::endl;
+	return ok?0:1;
+}
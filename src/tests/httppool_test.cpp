@@ -0,0 +1,125 @@
+/*
+ * httppool_test.cpp
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "../brokers/httpjson.h"
+#include "../brokers/httppool.h"
+#include "mockhttpserver.h"
+
+static simpleServer::HttpClient createClient() {
+	return simpleServer::HttpClient("MMBot test", simpleServer::newHttpsProvider(), simpleServer::newNoProxyProvider());
+}
+
+static MockHttpServer::Response okResponse(const MockHttpServer::Request &) {
+	return MockHttpServer::Response{200, "{\"ok\":true}"};
+}
+
+static std::uint64_t elapsedMs(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+///Clients with the same settings (subaccounts) share the idle connection, other template doesn't take it
+static bool testReuseAcrossClients() {
+	MockHttpServer srv(okResponse);
+	HTTPJson a(createClient(), srv.getUrl(""));
+	HTTPJson b(createClient(), srv.getUrl(""));
+	a.GET("/a");
+	b.GET("/b");
+	if (srv.getConnections() != 1) {
+		std::cerr << "connection was not reused by other client: " << srv.getConnections() << std::endl;
+		return false;
+	}
+	HTTPJson c(createClient(), srv.getUrl(""), "other");
+	c.GET("/c");
+	if (srv.getConnections() != 2) {
+		std::cerr << "connection was reused by client with different template" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+///Request waits for free slot of the host, it fails when no slot is released in time
+static bool testMaxPerHost() {
+	HttpClientPool::Config cfg;
+	cfg.maxPerHost = 1;
+	cfg.acquireTimeout = 200;
+	HttpClientPool pool(cfg);
+	simpleServer::HttpClient templ = createClient();
+	std::uint64_t id = HttpClientPool::templateId("test");
+	const char *url = "http://127.0.0.1:1/test";
+
+	auto first = std::make_unique<HttpClientPool::Connection>(pool.acquire(templ, id, url));
+	auto start = std::chrono::steady_clock::now();
+	bool thrown = false;
+	try {
+		pool.acquire(templ, id, url);
+	} catch (std::exception &) {
+		thrown = true;
+	}
+	if (!thrown || elapsedMs(start) < 150) {
+		std::cerr << "acquire didn't wait for the slot" << std::endl;
+		return false;
+	}
+
+	cfg.acquireTimeout = 5000;
+	pool.setConfig(cfg);
+	start = std::chrono::steady_clock::now();
+	auto second = std::async(std::launch::async, [&]{
+		pool.acquire(templ, id, url);
+		return elapsedMs(start);
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	first.reset();
+	if (second.wait_for(std::chrono::seconds(5)) != std::future_status::ready) {
+		std::cerr << "released slot was not passed to the waiting request" << std::endl;
+		return false;
+	}
+	try {
+		if (second.get() < 100) {
+			std::cerr << "limit of concurrent requests was not applied" << std::endl;
+			return false;
+		}
+	} catch (std::exception &e) {
+		std::cerr << "waiting request failed: " << e.what() << std::endl;
+		return false;
+	}
+	return true;
+}
+
+///Idle connection closed by the server is replaced by new connection
+static bool testStaleRetry() {
+	MockHttpServer srv(okResponse);
+	srv.setKeepAlive(false);
+	HTTPJson a(createClient(), srv.getUrl(""));
+	try {
+		a.GET("/1");
+		//let the server close the connection
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		a.GET("/2");
+	} catch (std::exception &e) {
+		std::cerr << "request on the stale connection failed: " << e.what() << std::endl;
+		return false;
+	}
+	if (srv.getRequests().size() != 2 || srv.getConnections() != 2) {
+		std::cerr << "request was not repeated on new connection" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+int main() {
+	bool ok = testReuseAcrossClients();
+	ok = testMaxPerHost() && ok;
+	ok = testStaleRetry() && ok;
+	std::cout << (ok?"OK":"FAILED") << std::endl;
+	return ok?0:1;
+}
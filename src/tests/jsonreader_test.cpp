@@ -0,0 +1,135 @@
+/*
+ * jsonreader_test.cpp
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#include <array>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "../brokers/jsonreader.h"
+
+static bool check(bool cond, const char *msg) {
+	if (!cond) std::cerr << msg << std::endl;
+	return cond;
+}
+
+template<typename Fn>
+static bool throws(Fn &&fn) {
+	try {
+		fn();
+		return false;
+	} catch (const std::runtime_error &) {
+		return true;
+	}
+}
+
+///Escaped quotes don't terminate the string
+static bool testEscapedQuotes() {
+	JsonReader rd(R"([{"s":"a\"b","x":"c\\"}])");
+	std::string_view s, x;
+	rd.openArray();
+	rd.forEachObject(std::array<std::string_view,2>{"s","x"}, [&](const std::array<std::string_view,2> &v) {
+		s = v[0];
+		x = v[1];
+	});
+	bool ok = check(s == R"(a\"b)" && x == R"(c\\)", "escaped quotes: unexpected values");
+
+	JsonReader rd2(R"({"skip":"q\"},\"","want":1})");
+	rd2.openObject();
+	ok = check(rd2.find("want") && rd2.readRaw() == "1", "escaped quotes: skipped string ended at the escaped quote") && ok;
+	return ok;
+}
+
+///Nested objects and arrays are skipped, brackets in strings are ignored
+static bool testNestedSkip() {
+	JsonReader rd(R"({"a":{"b":[1,{"c":"]}"}],"d":{}},"e":[[],[[]]],"f":"ok"})");
+	rd.openObject();
+	bool ok = check(rd.find("f") && rd.readRaw() == "ok", "nested skip: field after nested values was not found");
+	JsonReader rd2(R"({"a":[1,2]})");
+	rd2.openObject();
+	ok = check(!rd2.find("b") && rd2.peek() == JsonReader::Type::end, "nested skip: missing key was found") && ok;
+	return ok;
+}
+
+///Numbers stored as strings are parsed, tickers of other symbols are skipped
+static bool testNumbersAsStrings() {
+	JsonReader rd(R"([{"symbol":"ETH","bidPrice":"x","askPrice":"y"},{"symbol":"BTC","bidPrice":"100.5","askPrice":"101.5"}])");
+	IStockApi::Ticker tk{0,0,0,0};
+	readTickers(rd, JsonTickerFields{"symbol","bidPrice","askPrice",""}, 42, [&](std::string_view symbol) {
+		return symbol == "BTC"?&tk:nullptr;
+	});
+	bool ok = check(tk.bid == 100.5 && tk.ask == 101.5 && tk.last == 101 && tk.time == 42, "strings: unexpected ticker");
+	ok = check(JsonReader::toNumber("+1.5") == 1.5 && JsonReader::toNumber("1e3") == 1000, "strings: toNumber failed") && ok;
+	ok = check(JsonReader::toUInt("123") == 123 && JsonReader::toUInt("1.5e3") == 1500, "strings: toUInt failed") && ok;
+	ok = check(JsonReader::requireNumber("-0.25") == -0.25, "strings: requireNumber failed") && ok;
+	return ok;
+}
+
+///Missing fields are empty, missing or invalid price is an error
+static bool testMissingFields() {
+	JsonReader rd(R"([[1],[1,2,3,4]])");
+	unsigned int count = 0;
+	bool ok = true;
+	rd.openArray();
+	rd.forEachArray<3>([&](const std::array<std::string_view,3> &v) {
+		if (count++ == 0) ok = check(v[0] == "1" && v[1].empty() && v[2].empty(), "missing: items are not empty") && ok;
+		else ok = check(v[2] == "3", "missing: unexpected item") && ok;
+	});
+	ok = check(count == 2, "missing: unexpected count of arrays") && ok;
+
+	ok = check(throws([]{
+		JsonReader rd(R"([{"symbol":"BTC","bidPrice":"100"}])");
+		IStockApi::Ticker tk;
+		readTickers(rd, JsonTickerFields{"symbol","bidPrice","askPrice",""}, 0, [&](std::string_view) {return &tk;});
+	}), "missing: ticker without ask was accepted") && ok;
+	ok = check(throws([]{
+		JsonReader rd(R"([{"id":1,"time":1,"qty":"abc","price":"1"}])");
+		readTrades(rd, JsonTradeFields{"id","time","qty","price",""}, [](const IStockApi::Trade &) {});
+	}), "missing: trade with invalid size was accepted") && ok;
+	ok = check(throws([]{JsonReader::requireNumber("");}), "missing: empty number was accepted") && ok;
+	ok = check(throws([]{JsonReader::requireNumber("12abc");}), "missing: partial number was accepted") && ok;
+	return ok;
+}
+
+///Truncated input throws and the reader never reads after the end of the text
+static bool testTruncated() {
+	//every prefix is followed by the rest of the valid text, so reading past the end would succeed
+	std::string_view full = R"([{"a":"x\"y","n":12,"b":[1,{"c":"}"}]},{"a":"z"}])";
+	bool ok = true;
+	for (std::size_t len = 1; len < full.size(); len++) {
+		std::string_view part = full.substr(0, len);
+		bool t1 = throws([&]{
+			JsonReader rd(part);
+			rd.openArray();
+			rd.forEachObject(std::array<std::string_view,3>{"a","n","b"}, [](const std::array<std::string_view,3> &) {});
+		});
+		bool t2 = throws([&]{
+			JsonReader rd(part);
+			rd.skip();
+		});
+		if (!t1 || !t2) {
+			std::cerr << "truncated: no exception for: " << part << std::endl;
+			ok = false;
+		}
+	}
+	JsonReader rd(full);
+	unsigned int count = 0;
+	rd.openArray();
+	rd.forEachObject(std::array<std::string_view,1>{"a"}, [&](const std::array<std::string_view,1> &) {count++;});
+	ok = check(count == 2, "truncated: complete text was not read") && ok;
+	return ok;
+}
+
+int main() {
+	bool ok = testEscapedQuotes();
+	ok = testNestedSkip() && ok;
+	ok = testNumbersAsStrings() && ok;
+	ok = testMissingFields() && ok;
+	ok = testTruncated() && ok;
+	std::cout << (ok?"OK":"FAILED") << std::endl;
+	return ok?0:1;
+}
@@ -0,0 +1,255 @@
+/*
+ * marketstream_test.cpp
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <imtjson/object.h>
+#include <imtjson/string.h>
+
+#include "../brokers/marketstream.h"
+
+///Minimal websocket server on the loopback
+/**
+ * It accepts connections, performs the handshake, waits for the subscription
+ * from the client and replies with the ticker of the subscribed pair. When it is
+ * constructed as silent, it accepts TCP connections but never answers the handshake
+ */
+class MockWsServer {
+public:
+	MockWsServer(bool silent):silent(silent) {
+		sock = socket(AF_INET, SOCK_STREAM, 0);
+		sockaddr_in addr = {};
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addr.sin_port = 0;
+		bind(sock, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+		socklen_t len = sizeof(addr);
+		getsockname(sock, reinterpret_cast<sockaddr *>(&addr), &len);
+		port = ntohs(addr.sin_port);
+		listen(sock, 4);
+		if (!silent) thr = std::thread([this]{worker();});
+	}
+	~MockWsServer() {
+		stopped = true;
+		shutdown(sock, SHUT_RDWR);
+		::close(sock);
+		if (thr.joinable()) thr.join();
+	}
+
+	std::string getUrl() const {
+		return "ws://127.0.0.1:" + std::to_string(port) + "/";
+	}
+
+protected:
+	bool silent;
+	int sock;
+	int port;
+	std::atomic<bool> stopped{false};
+	std::thread thr;
+
+	void worker() {
+		while (!stopped) {
+			int c = accept(sock, nullptr, nullptr);
+			if (c < 0) return;
+			serve(c);
+			::close(c);
+		}
+	}
+
+	static bool readAll(int c, void *buff, std::size_t size) {
+		char *p = reinterpret_cast<char *>(buff);
+		while (size) {
+			ssize_t r = ::read(c, p, size);
+			if (r <= 0) return false;
+			p += r;
+			size -= r;
+		}
+		return true;
+	}
+
+	static void writeAll(int c, const std::string &data) {
+		std::size_t p = 0;
+		while (p < data.size()) {
+			ssize_t r = ::write(c, data.data()+p, data.size()-p);
+			if (r <= 0) return;
+			p += r;
+		}
+	}
+
+	static std::string acceptKey(const std::string &key) {
+		std::string k = key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+		unsigned char hash[SHA_DIGEST_LENGTH];
+		SHA1(reinterpret_cast<const unsigned char *>(k.data()), k.size(), hash);
+		unsigned char out[64];
+		int len = EVP_EncodeBlock(out, hash, SHA_DIGEST_LENGTH);
+		return std::string(reinterpret_cast<char *>(out), len);
+	}
+
+	static std::string readFrame(int c) {
+		unsigned char hdr[2];
+		if (!readAll(c, hdr, 2)) return std::string();
+		std::uint64_t len = hdr[1] & 0x7F;
+		if (len == 126) {
+			unsigned char ext[2];
+			if (!readAll(c, ext, 2)) return std::string();
+			len = (ext[0] << 8) | ext[1];
+		} else if (len == 127) {
+			unsigned char ext[8];
+			if (!readAll(c, ext, 8)) return std::string();
+			len = 0;
+			for (unsigned char b: ext) len = (len << 8) | b;
+		}
+		unsigned char mask[4] = {0,0,0,0};
+		if ((hdr[1] & 0x80) && !readAll(c, mask, 4)) return std::string();
+		std::string data(len, '\0');
+		if (!readAll(c, data.data(), len)) return std::string();
+		for (std::size_t i = 0; i < len; i++) data[i] ^= mask[i & 3];
+		return data;
+	}
+
+	static void writeText(int c, const std::string &text) {
+		std::string frame;
+		frame.push_back(static_cast<char>(0x81));
+		if (text.size() < 126) {
+			frame.push_back(static_cast<char>(text.size()));
+		} else {
+			frame.push_back(126);
+			frame.push_back(static_cast<char>(text.size() >> 8));
+			frame.push_back(static_cast<char>(text.size() & 0xFF));
+		}
+		frame.append(text);
+		writeAll(c, frame);
+	}
+
+	void serve(int c) {
+		std::string req;
+		char ch;
+		while (req.find("\r\n\r\n") == req.npos) {
+			if (::read(c, &ch, 1) != 1) return;
+			req.push_back(ch);
+		}
+		std::string key;
+		std::size_t p = req.find("Sec-WebSocket-Key:");
+		if (p == req.npos) p = req.find("sec-websocket-key:");
+		if (p == req.npos) return;
+		p += 18;
+		while (req[p] == ' ') p++;
+		key = req.substr(p, req.find("\r\n", p) - p);
+		writeAll(c, "HTTP/1.1 101 Switching Protocols\r\n"
+				"Upgrade: websocket\r\n"
+				"Connection: Upgrade\r\n"
+				"Sec-WebSocket-Accept: " + acceptKey(key) + "\r\n\r\n");
+		while (!stopped) {
+			std::string msg = readFrame(c);
+			if (msg.empty()) return;
+			json::Value v = json::Value::fromString(msg);
+			writeText(c, json::Value(json::Object
+					("s", v["sub"])
+					("b", 99.5)
+					("a", 100.5)
+					("c", 100.0)
+					("E", 1)).stringify().str());
+		}
+	}
+};
+
+class TestProtocol: public MarketDataStream::IProtocol {
+public:
+	TestProtocol(const std::string &url):url(url) {}
+	virtual std::string getUrl() override {return url;}
+	virtual void subscribe(simpleServer::WebSocketStream &ws, const std::string &pair) override {
+		ws.postText(json::Value(json::Object("sub", pair)).stringify());
+	}
+	virtual void onMessage(MarketDataStream &stream, json::Value msg) override {
+		stream.updateTicker(msg["s"].getString(), IStockApi::Ticker{
+			msg["b"].getNumber(),
+			msg["a"].getNumber(),
+			msg["c"].getNumber(),
+			msg["E"].getUIntLong()
+		});
+	}
+	virtual unsigned int getIOTimeout() const override {return 3000;}
+protected:
+	std::string url;
+};
+
+template<typename Fn>
+static bool waitFor(Fn &&fn) {
+	auto end = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+	while (!fn()) {
+		if (std::chrono::steady_clock::now() > end) return false;
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	return true;
+}
+
+///Ticker arrives through the stream, cached orders are dropped after invalidation
+static bool testTickerAndOrders() {
+	MockWsServer srv(false);
+	MarketDataStream stream(simpleServer::HttpClient("MMBot test"), std::make_unique<TestProtocol>(srv.getUrl()));
+	std::optional<IStockApi::Ticker> tk;
+	if (!waitFor([&]{tk = stream.getTicker("TEST");return tk.has_value();})) {
+		std::cerr << "ticker was not received" << std::endl;
+		return false;
+	}
+	if (tk->bid != 99.5 || tk->ask != 100.5) {
+		std::cerr << "unexpected ticker" << std::endl;
+		return false;
+	}
+	unsigned int ver = stream.getOrdersVersion("TEST");
+	stream.setOrders("TEST", IStockApi::Orders{IStockApi::Order{1, 2, 1.0, 100.0}}, ver);
+	if (!stream.getOpenOrders("TEST").has_value()) {
+		std::cerr << "orders are not cached" << std::endl;
+		return false;
+	}
+	stream.invalidateOrders("TEST");
+	if (stream.getOpenOrders("TEST").has_value()) {
+		std::cerr << "orders are served after invalidation" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+///Cache doesn't block while the stream is connecting
+static bool testConnectDoesntBlock() {
+	auto srv = std::make_unique<MockWsServer>(true);
+	MarketDataStream stream(simpleServer::HttpClient("MMBot test"), std::make_unique<TestProtocol>(srv->getUrl()));
+	stream.subscribe("TEST");
+	//let the worker enter the handshake
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	auto start = std::chrono::steady_clock::now();
+	auto tk = stream.getTicker("TEST");
+	bool nd = stream.needSyncTrades("TEST");
+	auto elapsed = std::chrono::steady_clock::now() - start;
+	bool ok = true;
+	if (tk.has_value() || !nd) {
+		std::cerr << "unconnected stream serves data" << std::endl;
+		ok = false;
+	}
+	if (elapsed > std::chrono::milliseconds(100)) {
+		std::cerr << "cache is blocked by the connecting stream" << std::endl;
+		ok = false;
+	}
+	//closing the server resets the pending connection, so the stream can stop
+	srv.reset();
+	return ok;
+}
+
+int main() {
+	bool ok = testTickerAndOrders();
+	ok = testConnectDoesntBlock() && ok;
+	std::cout << (ok?"OK":"FAILED") << std::endl;
+	return ok?0:1;
+}
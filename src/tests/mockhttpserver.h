@@ -0,0 +1,157 @@
+/*
+ * mockhttpserver.h
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#ifndef SRC_TESTS_MOCKHTTPSERVER_H_
+#define SRC_TESTS_MOCKHTTPSERVER_H_
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+///Minimal HTTP server on the loopback, requests are answered by the handler
+class MockHttpServer {
+public:
+	struct Request {
+		std::string method;
+		std::string path;
+		std::string body;
+	};
+	struct Response {
+		int status;
+		std::string body;
+	};
+	using Handler = std::function<Response(const Request &)>;
+
+	MockHttpServer(Handler &&handler):handler(std::move(handler)) {
+		sock = socket(AF_INET, SOCK_STREAM, 0);
+		sockaddr_in addr = {};
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addr.sin_port = 0;
+		bind(sock, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+		socklen_t len = sizeof(addr);
+		getsockname(sock, reinterpret_cast<sockaddr *>(&addr), &len);
+		port = ntohs(addr.sin_port);
+		listen(sock, 4);
+		thr = std::thread([this]{worker();});
+	}
+	~MockHttpServer() {
+		stopped = true;
+		shutdown(sock, SHUT_RDWR);
+		::close(sock);
+		thr.join();
+		{
+			std::unique_lock _(lock);
+			for (int c: clients) shutdown(c, SHUT_RDWR);
+		}
+		for (auto &t: conns) t.join();
+	}
+
+	std::string getUrl(const std::string &path) const {
+		return "http://127.0.0.1:" + std::to_string(port) + path;
+	}
+
+	std::vector<Request> getRequests() {
+		std::unique_lock _(lock);
+		return requests;
+	}
+
+	///Count of accepted TCP connections
+	unsigned int getConnections() const {return connections;}
+
+	///When disabled, server closes the connection after the response, while it still announces keep-alive
+	/** It simulates keep-alive connection closed by the server while it is idle */
+	void setKeepAlive(bool enable) {keepAlive = enable;}
+
+protected:
+	Handler handler;
+	int sock;
+	int port;
+	std::atomic<bool> stopped{false};
+	std::atomic<bool> keepAlive{true};
+	std::atomic<unsigned int> connections{0};
+	std::thread thr;
+	std::mutex lock;
+	std::vector<int> clients;
+	std::vector<std::thread> conns;
+	std::vector<Request> requests;
+
+	void worker() {
+		while (!stopped) {
+			int c = accept(sock, nullptr, nullptr);
+			if (c < 0) return;
+			connections++;
+			std::unique_lock _(lock);
+			clients.push_back(c);
+			conns.emplace_back([this, c]{serve(c);});
+		}
+	}
+
+	static bool readAll(int c, std::string &buff, std::size_t size) {
+		char b[4096];
+		while (buff.size() < size) {
+			ssize_t r = ::read(c, b, std::min(sizeof(b), size - buff.size()));
+			if (r <= 0) return false;
+			buff.append(b, r);
+		}
+		return true;
+	}
+
+	static void writeAll(int c, const std::string &data) {
+		std::size_t p = 0;
+		while (p < data.size()) {
+			ssize_t r = ::write(c, data.data()+p, data.size()-p);
+			if (r <= 0) return;
+			p += r;
+		}
+	}
+
+	void serve(int c) {
+		while (!stopped) {
+			std::string hdr;
+			char ch;
+			while (hdr.find("\r\n\r\n") == hdr.npos) {
+				if (::read(c, &ch, 1) != 1) return;
+				hdr.push_back(ch);
+			}
+			Request req;
+			std::size_t sp1 = hdr.find(' ');
+			std::size_t sp2 = hdr.find(' ', sp1+1);
+			req.method = hdr.substr(0, sp1);
+			req.path = hdr.substr(sp1+1, sp2-sp1-1);
+			std::string lhdr = hdr;
+			std::transform(lhdr.begin(), lhdr.end(), lhdr.begin(), [](unsigned char c){return std::tolower(c);});
+			std::size_t p = lhdr.find("content-length:");
+			std::size_t len = p == lhdr.npos?0:std::strtoul(lhdr.c_str()+p+15, nullptr, 10);
+			if (!readAll(c, req.body, len)) return;
+			Response resp = handler(req);
+			{
+				std::unique_lock _(lock);
+				requests.push_back(req);
+			}
+			writeAll(c, "HTTP/1.1 " + std::to_string(resp.status) + " Status\r\n"
+					"Content-Type: application/json\r\n"
+					"Connection: keep-alive\r\n"
+					"Content-Length: " + std::to_string(resp.body.size()) + "\r\n\r\n" + resp.body);
+			if (!keepAlive) {
+				shutdown(c, SHUT_RDWR);
+				return;
+			}
+		}
+	}
+};
+
+#endif /* SRC_TESTS_MOCKHTTPSERVER_H_ */
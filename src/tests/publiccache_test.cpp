@@ -0,0 +1,131 @@
+/*
+ * publiccache_test.cpp
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <imtjson/value.h>
+
+#include "../brokers/publiccache.h"
+
+static bool check(bool cond, const char *msg) {
+	if (!cond) std::cerr << msg << std::endl;
+	return cond;
+}
+
+template<typename Fn>
+static bool throws(Fn &&fn) {
+	try {
+		fn();
+		return false;
+	} catch (const std::runtime_error &) {
+		return true;
+	}
+}
+
+///Data are served from the cache until their ttl expires
+static bool testTTL() {
+	PublicDataCache cache;
+	int calls = 0;
+	auto fetch = [&]{return json::Value(++calls);};
+	bool ok = check(cache.get("a", 100, fetch).getInt() == 1, "ttl: first get didn't download");
+	ok = check(cache.get("a", 100, fetch).getInt() == 1, "ttl: fresh data were downloaded again") && ok;
+	std::this_thread::sleep_for(std::chrono::milliseconds(150));
+	ok = check(cache.get("a", 100, fetch).getInt() == 2, "ttl: expired data were not downloaded") && ok;
+	json::Value m = cache.getMetrics();
+	ok = check(m["hits"].getUInt() == 1 && m["misses"].getUInt() == 2, "ttl: unexpected metrics") && ok;
+	return ok;
+}
+
+///Concurrent requests of the same entry are served by single download
+static bool testSingleFlight() {
+	PublicDataCache cache;
+	std::atomic<int> calls{0};
+	auto fetch = [&]{
+		calls++;
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		return json::Value(42);
+	};
+	std::vector<std::future<int> > res;
+	for (int i = 0; i < 4; i++) {
+		res.push_back(std::async(std::launch::async, [&]{return cache.get("a", 10000, fetch).getInt();}));
+	}
+	bool ok = true;
+	for (auto &f: res) ok = check(f.get() == 42, "single flight: unexpected data") && ok;
+	ok = check(calls == 1, "single flight: data were downloaded more than once") && ok;
+	json::Value m = cache.getMetrics();
+	ok = check(m["misses"].getUInt() == 1 && m["waits"].getUInt() + m["hits"].getUInt() == 3, "single flight: unexpected metrics") && ok;
+	return ok;
+}
+
+///Error of the download is delivered to the waiting callers, next request downloads again
+static bool testError() {
+	PublicDataCache cache;
+	auto fail = []()->json::Value {
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		throw std::runtime_error("fail");
+	};
+	auto first = std::async(std::launch::async, [&]{return cache.get("a", 10000, fail);});
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	bool ok = check(throws([&]{cache.get("a", 10000, fail);}), "error: exception was not delivered to the waiting caller");
+	ok = check(throws([&]{first.get();}), "error: exception was not delivered to the downloading caller") && ok;
+	ok = check(cache.get("a", 10000, []{return json::Value(1);}).getInt() == 1, "error: failed download was cached") && ok;
+	return ok;
+}
+
+///Reset drops the data once per round, accounts reset later in the same round share them
+static bool testResetRound() {
+	PublicDataCache cache;
+	int calls = 0;
+	auto fetch = [&]{return json::Value(++calls);};
+	cache.reset(1);
+	cache.get("a", 10000, fetch);
+	cache.reset(1);
+	bool ok = check(cache.get("a", 10000, fetch).getInt() == 1, "reset: data were dropped twice in the same round");
+	cache.reset(2);
+	ok = check(cache.get("a", 10000, fetch).getInt() == 2, "reset: new round didn't drop the data") && ok;
+	cache.reset(0);
+	ok = check(cache.get("a", 10000, fetch).getInt() == 3, "reset: unknown round didn't drop the data") && ok;
+
+	int keep = 0;
+	auto fetchKeep = [&]{return json::Value(++keep);};
+	cache.get("info", PublicDataCache::keepTTL, fetchKeep);
+	cache.reset(3);
+	ok = check(cache.get("info", PublicDataCache::keepTTL, fetchKeep).getInt() == 1, "reset: long living data were dropped") && ok;
+	return ok;
+}
+
+///Data downloaded during reset belong to the previous round
+static bool testResetDuringFetch() {
+	PublicDataCache cache;
+	std::atomic<int> calls{0};
+	auto fetch = [&]{
+		int r = ++calls;
+		if (r == 1) std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		return json::Value(r);
+	};
+	cache.reset(1);
+	auto first = std::async(std::launch::async, [&]{return cache.get("a", 10000, fetch).getInt();});
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	cache.reset(2);
+	bool ok = check(first.get() == 1, "fetch: unexpected data");
+	ok = check(cache.get("a", 10000, fetch).getInt() == 2, "fetch: data of the previous round were used") && ok;
+	return ok;
+}
+
+int main() {
+	bool ok = testTTL();
+	ok = testSingleFlight() && ok;
+	ok = testError() && ok;
+	ok = testResetRound() && ok;
+	ok = testResetDuringFetch() && ok;
+	std::cout << (ok?"OK":"FAILED") << std::endl;
+	return ok?0:1;
+}
@@ -0,0 +1,69 @@
+/*
+ * quotedist_test.cpp
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#include "../simplefx/quotedist.h"
+
+///Listener releases the last reference to the distributor on the dispatcher thread
+static bool testListenerReleasesLastRef() {
+	PQuoteDistributor qd = new QuoteDistributor();
+	std::promise<void> released;
+	auto token = std::make_shared<int>(0);
+	std::weak_ptr<int> watch = token;
+
+	qd->createRegFn("TEST")([&qd, &released, token](const IStockApi::Ticker &) {
+		qd = nullptr;
+		released.set_value();
+		return false;
+	});
+	qd->createReceiveFn()("TEST", 1.0, 1.1, 0);
+
+	if (released.get_future().wait_for(std::chrono::seconds(5)) != std::future_status::ready) {
+		std::cerr << "listener was not called" << std::endl;
+		return false;
+	}
+	token.reset();
+	//shared state (and the listener) is released when the dispatcher exits
+	auto end = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+	while (!watch.expired()) {
+		if (std::chrono::steady_clock::now() > end) {
+			std::cerr << "dispatcher didn't release the state" << std::endl;
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return true;
+}
+
+///Distributor destroyed by other thread stops the dispatcher
+static bool testDestroyOutside() {
+	std::promise<void> called;
+	{
+		PQuoteDistributor qd = new QuoteDistributor();
+		qd->createRegFn("TEST")([&called](const IStockApi::Ticker &tk) {
+			if (tk.bid == 2.0) called.set_value();
+			return true;
+		});
+		qd->createReceiveFn()("TEST", 2.0, 2.1, 0);
+		if (called.get_future().wait_for(std::chrono::seconds(5)) != std::future_status::ready) {
+			std::cerr << "quote was not delivered" << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+int main() {
+	bool ok = testListenerReleasesLastRef();
+	ok = testDestroyOutside() && ok;
+	std::cout << (ok?"OK":"FAILED") << std::endl;
+	return ok?0:1;
+}
@@ -0,0 +1,226 @@
+/*
+ * spooler_test.cpp
+ *
+ *  Created on: 19. 10. 2026
+ */
+
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <imtjson/array.h>
+#include <imtjson/object.h>
+#include <imtjson/string.h>
+
+#include "../report_broker/delivery.h"
+#include "../report_broker/spooler.h"
+#include "mockhttpserver.h"
+
+using json::Object;
+using json::Value;
+
+template<typename Fn>
+static bool waitFor(Fn &&fn) {
+	auto end = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+	while (!fn()) {
+		if (std::chrono::steady_clock::now() > end) return false;
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	return true;
+}
+
+static std::vector<Value> readLines(const std::string &fname) {
+	std::vector<Value> res;
+	std::ifstream f(fname);
+	std::string line;
+	while (std::getline(f, line)) {
+		if (!line.empty()) res.push_back(Value::fromString(line));
+	}
+	return res;
+}
+
+static std::size_t fileSize(const std::string &fname) {
+	std::ifstream f(fname, std::ios::binary|std::ios::ate);
+	return !f?0:static_cast<std::size_t>(f.tellg());
+}
+
+static Value makeItem(const Config &cfg, const char *tradeId, double change) {
+	return prepareItem(cfg, Object
+			("uid", 1)
+			("tradeId", tradeId)
+			("currency", "usd")
+			("change", change));
+}
+
+class TestEnv {
+public:
+	TestEnv() {
+		char tmpl[] = "/tmp/spooler_testXXXXXX";
+		dir = mkdtemp(tmpl);
+	}
+	~TestEnv() {
+		std::remove((file()).c_str());
+		std::remove((file()+".pos").c_str());
+		std::remove((file()+".pos.tmp").c_str());
+		std::remove((file()+".rejected").c_str());
+		rmdir(dir.c_str());
+	}
+	std::string file() const {return dir + "/work.spool";}
+protected:
+	std::string dir;
+};
+
+static HTTPJson createClient() {
+	return HTTPJson(simpleServer::HttpClient("MMBot test", simpleServer::newHttpsProvider(), simpleServer::newNoProxyProvider()), "");
+}
+
+///Item refused by the server in single mode is moved to the dead-letter file, the rest is delivered
+static bool testRejectedSingle() {
+	TestEnv env;
+	MockHttpServer srv([](const MockHttpServer::Request &req) {
+		Value v = Value::fromString(req.body);
+		if (v["tradeId"].getString() == "bad") return MockHttpServer::Response{400, ""};
+		return MockHttpServer::Response{201, "{\"ok\":true}"};
+	});
+	Config cfg;
+	cfg.ident = "test";
+	cfg.postUrl = srv.getUrl("/item");
+	cfg.postMethod = "PUT";
+	cfg.batchSize = 10;
+	HTTPJson httpc = createClient();
+	std::vector<std::string> errors;
+	std::mutex errlock;
+	{
+		Spooler spooler(env.file(), cfg.batchSize, [&](const std::vector<Value> &items) {
+			return sendItems(httpc, cfg, items);
+		}, [&](const std::string &msg) {
+			std::unique_lock _(errlock);
+			errors.push_back(msg);
+		});
+		spooler.push(makeItem(cfg, "t1", 1));
+		spooler.push(makeItem(cfg, "bad", 2));
+		spooler.push(makeItem(cfg, "t3", 3));
+		if (!waitFor([&]{return fileSize(env.file()) == 0 && srv.getRequests().size() == 3;})) {
+			std::cerr << "spool was not delivered" << std::endl;
+			return false;
+		}
+		//rejected item must not be repeated
+		std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+	}
+	if (srv.getRequests().size() != 3) {
+		std::cerr << "rejected item was sent again" << std::endl;
+		return false;
+	}
+	auto rej = readLines(env.file()+".rejected");
+	if (rej.size() != 1 || rej[0]["tradeId"].getString() != "bad") {
+		std::cerr << "rejected item is not in the dead-letter file" << std::endl;
+		return false;
+	}
+	if (errors.empty()) {
+		std::cerr << "rejection was not reported" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+///Bulk mode calculates btc and fees, the item refused by validation is moved to the dead-letter file
+static bool testBulk() {
+	TestEnv env;
+	std::mutex lock;
+	std::vector<Value> stored;
+	MockHttpServer srv([&](const MockHttpServer::Request &req) {
+		if (req.method == "GET" && req.path == "/rates") {
+			return MockHttpServer::Response{200, "{\"rates\":{\"USD\":0.0001},\"fees\":{\"general\":0.1}}"};
+		}
+		if (req.method == "POST" && req.path == "/bulk") {
+			json::Array resp;
+			for (Value d: Value::fromString(req.body)["docs"]) {
+				if (d["tradeId"].getString() == "bad") {
+					resp.push_back(Object("id", d["_id"])("error","forbidden")("reason","invalid trade"));
+				} else {
+					std::unique_lock _(lock);
+					stored.push_back(d);
+					resp.push_back(Object("id", d["_id"])("ok", true));
+				}
+			}
+			return MockHttpServer::Response{201, Value(resp).stringify().str()};
+		}
+		return MockHttpServer::Response{404, ""};
+	});
+	Config cfg;
+	cfg.ident = "test";
+	cfg.postUrl = srv.getUrl("/item");
+	cfg.postMethod = "PUT";
+	cfg.bulkUrl = srv.getUrl("/bulk");
+	cfg.ratesUrl = srv.getUrl("/rates");
+	cfg.batchSize = 10;
+	HTTPJson httpc = createClient();
+	{
+		Spooler spooler(env.file(), cfg.batchSize, [&](const std::vector<Value> &items) {
+			return sendItems(httpc, cfg, items);
+		}, [](const std::string &) {});
+		spooler.push(makeItem(cfg, "t1", 1000));
+		spooler.push(makeItem(cfg, "bad", 2000));
+		if (!waitFor([&]{return fileSize(env.file()) == 0;})) {
+			std::cerr << "spool was not delivered" << std::endl;
+			return false;
+		}
+	}
+	std::unique_lock _(lock);
+	if (stored.size() != 1 || std::abs(stored[0]["btc"].getNumber() - 0.1) > 1e-9
+			|| std::abs(stored[0]["fees"].getNumber() + 0.01) > 1e-9) {
+		std::cerr << "btc and fees were not calculated" << std::endl;
+		return false;
+	}
+	auto rej = readLines(env.file()+".rejected");
+	if (rej.size() != 1 || rej[0]["tradeId"].getString() != "bad") {
+		std::cerr << "rejected item is not in the dead-letter file" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+///Server error is not permanent, the item is delivered once the server accepts it
+static bool testRetry() {
+	TestEnv env;
+	std::atomic<int> calls{0};
+	MockHttpServer srv([&](const MockHttpServer::Request &) {
+		if (calls++ == 0) return MockHttpServer::Response{503, ""};
+		return MockHttpServer::Response{201, "{\"ok\":true}"};
+	});
+	Config cfg;
+	cfg.ident = "test";
+	cfg.postUrl = srv.getUrl("/item");
+	cfg.postMethod = "PUT";
+	cfg.batchSize = 10;
+	HTTPJson httpc = createClient();
+	Spooler spooler(env.file(), cfg.batchSize, [&](const std::vector<Value> &items) {
+		return sendItems(httpc, cfg, items);
+	}, [](const std::string &) {});
+	spooler.push(makeItem(cfg, "t1", 1));
+	if (!waitFor([&]{return fileSize(env.file()) == 0;})) {
+		std::cerr << "item was not delivered after the server error" << std::endl;
+		return false;
+	}
+	if (calls != 2 || fileSize(env.file()+".rejected") != 0) {
+		std::cerr << "temporary error handled as permanent" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+int main() {
+	bool ok = testRejectedSingle();
+	ok = testBulk() && ok;
+	ok = testRetry() && ok;
+	std::cout << (ok?"OK":"FAILED") << std::endl;
+	return ok?0:1;
+}
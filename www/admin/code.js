@@ -775,6 +775,7 @@ App.prototype.saveForm = function(form, src) {
 	trader.title = data.title;
 	trader.enabled = data.enabled;
 	trader.dry_run = data.dry_run;
+	trader.emulator = src.emulator;
 	trader.hidden = data.hidden;
 	this.advanced = data.advanced;
 	trader.accept_loss = data.accept_loss;
@@ -1957,6 +1958,12 @@ App.prototype.tradingForm = function(id) {
 								+" @ " + adjNumN(invp(x.price))
 					}}
 				});
+				formdata.profile = (rs.profile || []).map(function(x) {
+					return {phase:x.phase,
+						p50:x.p50.toFixed(1),
+						p99:x.p99.toFixed(1),
+						max:x.max.toFixed(1)};
+				});
 				formdata.orders = orders.map(function(x) {
 					return {id:x.id,
 						dir:invs(x.size)<0?_this.strtable.sell:_this.strtable.buy,